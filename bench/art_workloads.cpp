@@ -0,0 +1,387 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/art_key.hpp"
+#include <algorithm>
+#include <cmath>
+#include <malloc.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// AdaptiveRadixTree against std::map, std::unordered_map and a sorted vector on several key
+// distributions. Every input is generated from Seed, so numbers compare across releases.
+// Results are also written to art_workloads.json unless --benchmark_out is given.
+
+static constexpr uint64_t Seed = 20240601;
+static constexpr size_t NUM_KEYS = 500000;
+static constexpr size_t NUM_LOOKUPS = 1 << 20;
+static constexpr size_t RANGE_LENGTH = 100;
+static constexpr double ZIPF_SKEW = 0.99;
+
+enum class Dataset { DenseInt, SparseInt, Url, Email };
+
+static const char *dataset_name(Dataset dataset) {
+    switch (dataset) {
+    case Dataset::DenseInt:
+        return "dense_int";
+    case Dataset::SparseInt:
+        return "sparse_int";
+    case Dataset::Url:
+        return "url";
+    case Dataset::Email:
+        break;
+    }
+    return "email";
+}
+
+// 8 byte big-endian strings, ordered like the integers
+static std::string int_key(uint64_t value) {
+    auto encoded = ArtKeyTraits<uint64_t>::encode(value);
+    return std::string(encoded.data(), encoded.size());
+}
+
+// few hosts, shared path sections, numeric ids at the end
+static std::string url_key(std::mt19937_64 &rng) {
+    static const char *sections[] = {"api", "static", "users", "orders",
+                                     "search", "img", "v1", "v2"};
+    std::string key = "https://www.site" + std::to_string(rng() % 2000) + ".com";
+    for (size_t depth = 1 + rng() % 4; depth > 0; depth--) {
+        key += '/';
+        key += sections[rng() % std::size(sections)];
+    }
+    return key + '/' + std::to_string(rng() % 100000);
+}
+
+static std::string email_key(std::mt19937_64 &rng) {
+    static const char *names[] = {"alice", "bob",   "carol", "dave", "erin",
+                                  "frank", "grace", "heidi", "ivan", "judy"};
+    static const char *domains[] = {"gmail.com", "yahoo.com", "outlook.com", "example.org",
+                                    "corp.example.com"};
+    std::string key = std::string(names[rng() % std::size(names)]) + '.';
+    key += names[rng() % std::size(names)] + std::to_string(rng() % 100000) + '@';
+    return key + domains[rng() % std::size(domains)];
+}
+
+static std::string make_key(Dataset dataset, std::mt19937_64 &rng, uint64_t i) {
+    switch (dataset) {
+    case Dataset::DenseInt:
+        return int_key(i);
+    case Dataset::SparseInt:
+        return int_key(rng());
+    case Dataset::Url:
+        return url_key(rng);
+    case Dataset::Email:
+        break;
+    }
+    return email_key(rng);
+}
+
+struct Keys {
+    std::vector<std::string> present; // distinct, in insertion order
+    std::vector<std::string> missing; // same shape, never inserted
+    std::vector<uint32_t> zipf;       // indices into present, a few keys take most lookups
+};
+
+static const Keys &keys(Dataset dataset) {
+    static std::mutex mutex;
+    static std::map<Dataset, Keys> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto it = cache.find(dataset); it != cache.end()) {
+        return it->second;
+    }
+
+    Keys &keys = cache[dataset];
+    std::mt19937_64 rng(Seed + static_cast<uint64_t>(dataset));
+    std::unordered_set<std::string> seen;
+    for (uint64_t i = 0; keys.present.size() < NUM_KEYS; i++) {
+        if (auto key = make_key(dataset, rng, i); seen.insert(key).second) {
+            keys.present.push_back(std::move(key));
+        }
+    }
+    for (uint64_t i = NUM_KEYS; keys.missing.size() < NUM_KEYS; i++) {
+        if (auto key = make_key(dataset, rng, i); !seen.contains(key)) {
+            keys.missing.push_back(std::move(key));
+        }
+    }
+    std::shuffle(keys.present.begin(), keys.present.end(), rng);
+    std::shuffle(keys.missing.begin(), keys.missing.end(), rng);
+
+    // rank r is drawn with weight 1 / (r + 1)^ZIPF_SKEW
+    std::vector<double> cdf(NUM_KEYS);
+    double sum = 0;
+    for (size_t rank = 0; rank < NUM_KEYS; rank++) {
+        sum += 1.0 / std::pow(static_cast<double>(rank + 1), ZIPF_SKEW);
+        cdf[rank] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0, sum);
+    keys.zipf.resize(NUM_LOOKUPS);
+    for (auto &index : keys.zipf) {
+        auto rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        index = static_cast<uint32_t>(std::min<size_t>(static_cast<size_t>(rank), NUM_KEYS - 1));
+    }
+    return keys;
+}
+
+// The indexes share one interface, Ordered and Removable tell which benchmarks apply.
+struct ArtIndex {
+    static constexpr const char *Name = "art";
+    static constexpr bool Ordered = true;
+    static constexpr bool Removable = true;
+    AdaptiveRadixTree<uint64_t> tree;
+
+    void insert(const std::string &key, uint64_t value) { tree.insert(key, value); }
+    void finish() {}
+    bool contains(const std::string &key) const { return tree.find(key) != nullptr; }
+    bool remove(const std::string &key) { return tree.remove(key); }
+    uint64_t scan() {
+        uint64_t sum = 0;
+        for (const auto &leaf : tree) {
+            sum += leaf.value;
+        }
+        return sum;
+    }
+    uint64_t range(const std::string &from) {
+        uint64_t sum = 0;
+        auto it = tree.lower_bound(from);
+        for (size_t i = 0; i < RANGE_LENGTH && it != tree.end(); i++, ++it) {
+            sum += it->value;
+        }
+        return sum;
+    }
+};
+
+struct MapIndex {
+    static constexpr const char *Name = "std_map";
+    static constexpr bool Ordered = true;
+    static constexpr bool Removable = true;
+    std::map<std::string, uint64_t> map;
+
+    void insert(const std::string &key, uint64_t value) { map.insert_or_assign(key, value); }
+    void finish() {}
+    bool contains(const std::string &key) const { return map.find(key) != map.end(); }
+    bool remove(const std::string &key) { return map.erase(key) == 1; }
+    uint64_t scan() {
+        uint64_t sum = 0;
+        for (const auto &[key, value] : map) {
+            sum += value;
+        }
+        return sum;
+    }
+    uint64_t range(const std::string &from) {
+        uint64_t sum = 0;
+        auto it = map.lower_bound(from);
+        for (size_t i = 0; i < RANGE_LENGTH && it != map.end(); i++, ++it) {
+            sum += it->second;
+        }
+        return sum;
+    }
+};
+
+struct HashIndex {
+    static constexpr const char *Name = "std_unordered_map";
+    static constexpr bool Ordered = false;
+    static constexpr bool Removable = true;
+    std::unordered_map<std::string, uint64_t> map;
+
+    void insert(const std::string &key, uint64_t value) { map.insert_or_assign(key, value); }
+    void finish() {}
+    bool contains(const std::string &key) const { return map.find(key) != map.end(); }
+    bool remove(const std::string &key) { return map.erase(key) == 1; }
+};
+
+// built in one go: append everything, then sort
+struct SortedVectorIndex {
+    static constexpr const char *Name = "sorted_vector";
+    static constexpr bool Ordered = true;
+    static constexpr bool Removable = false;
+    std::vector<std::pair<std::string, uint64_t>> items;
+
+    void insert(const std::string &key, uint64_t value) { items.emplace_back(key, value); }
+    void finish() { std::sort(items.begin(), items.end()); }
+    auto lower_bound(const std::string &key) const {
+        return std::lower_bound(
+            items.begin(), items.end(), key,
+            [](const auto &item, const std::string &k) { return item.first < k; });
+    }
+    bool contains(const std::string &key) const {
+        auto it = lower_bound(key);
+        return it != items.end() && it->first == key;
+    }
+    uint64_t scan() {
+        uint64_t sum = 0;
+        for (const auto &[key, value] : items) {
+            sum += value;
+        }
+        return sum;
+    }
+    uint64_t range(const std::string &from) {
+        uint64_t sum = 0;
+        auto it = lower_bound(from);
+        for (size_t i = 0; i < RANGE_LENGTH && it != items.end(); i++, ++it) {
+            sum += it->second;
+        }
+        return sum;
+    }
+};
+
+template <typename Index> static std::unique_ptr<Index> build(const Keys &keys) {
+    auto index = std::make_unique<Index>();
+    for (size_t i = 0; i < keys.present.size(); i++) {
+        index->insert(keys.present[i], i);
+    }
+    index->finish();
+    return index;
+}
+
+// Read-only benchmarks share one built index per type, rebuilt when the dataset changes.
+// Benchmarks run in registration order, grouped by dataset, so each is built once.
+template <typename Index> static Index &shared_index(Dataset dataset) {
+    static std::mutex mutex;
+    static std::unique_ptr<Index> index;
+    static Dataset built = Dataset::DenseInt;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!index || built != dataset) {
+        index.reset();
+        index = build<Index>(keys(dataset));
+        built = dataset;
+    }
+    return *index;
+}
+
+// memory per key from the allocator's own count of bytes in use
+template <typename Index> static void BM_Insert(benchmark::State &state, Dataset dataset) {
+    const Keys &input = keys(dataset);
+    for (auto _ : state) {
+        size_t before = mallinfo2().uordblks;
+        auto index = build<Index>(input);
+        state.PauseTiming();
+        state.counters["bytes_per_key"] = static_cast<double>(mallinfo2().uordblks - before) /
+                                          static_cast<double>(input.present.size());
+        index.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(input.present.size()));
+}
+
+template <typename Index> static void BM_Remove(benchmark::State &state, Dataset dataset) {
+    const Keys &input = keys(dataset);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto index = build<Index>(input);
+        state.ResumeTiming();
+        for (const auto &key : input.present) {
+            benchmark::DoNotOptimize(index->remove(key));
+        }
+        state.PauseTiming();
+        index.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(input.present.size()));
+}
+
+// Point lookups walking keys from a per-thread offset, Miss looks up keys that are absent.
+template <typename Index, bool Miss>
+static void BM_Lookup(benchmark::State &state, Dataset dataset) {
+    const Keys &input = keys(dataset);
+    const Index &index = shared_index<Index>(dataset);
+    const auto &lookups = Miss ? input.missing : input.present;
+    size_t i = lookups.size() / static_cast<size_t>(state.threads()) *
+               static_cast<size_t>(state.thread_index());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.contains(lookups[i]));
+        i = i + 1 == lookups.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Index> static void BM_LookupZipf(benchmark::State &state, Dataset dataset) {
+    const Keys &input = keys(dataset);
+    const Index &index = shared_index<Index>(dataset);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.contains(input.present[input.zipf[i]]));
+        i = i + 1 == input.zipf.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Index> static void BM_Scan(benchmark::State &state, Dataset dataset) {
+    Index &index = shared_index<Index>(dataset);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.scan());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(NUM_KEYS));
+}
+
+// lower_bound of a random key, then the next RANGE_LENGTH keys
+template <typename Index> static void BM_RangeScan(benchmark::State &state, Dataset dataset) {
+    const Keys &input = keys(dataset);
+    Index &index = shared_index<Index>(dataset);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.range(input.missing[i]));
+        i = i + 1 == input.missing.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(RANGE_LENGTH));
+}
+
+template <typename Index> static void register_index(Dataset dataset) {
+    std::string suffix = std::string("/") + Index::Name + "/" + dataset_name(dataset);
+    auto name = [&suffix](const char *operation) { return operation + suffix; };
+
+    // whole key set per iteration, fixed iteration counts keep runs comparable
+    benchmark::RegisterBenchmark(name("insert").c_str(), BM_Insert<Index>, dataset)
+        ->Unit(benchmark::kMillisecond)
+        ->Iterations(3);
+    if constexpr (Index::Removable) {
+        benchmark::RegisterBenchmark(name("remove").c_str(), BM_Remove<Index>, dataset)
+            ->Unit(benchmark::kMillisecond)
+            ->Iterations(3);
+    }
+    benchmark::RegisterBenchmark(name("lookup_hit").c_str(), BM_Lookup<Index, false>, dataset)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(name("lookup_miss").c_str(), BM_Lookup<Index, true>, dataset);
+    benchmark::RegisterBenchmark(name("lookup_zipf").c_str(), BM_LookupZipf<Index>, dataset);
+    if constexpr (Index::Ordered) {
+        benchmark::RegisterBenchmark(name("scan").c_str(), BM_Scan<Index>, dataset)
+            ->Unit(benchmark::kMillisecond)
+            ->Iterations(3);
+        benchmark::RegisterBenchmark(name("range").c_str(), BM_RangeScan<Index>, dataset);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<char *> args(argv, argv + argc);
+    std::string out = "--benchmark_out=art_workloads.json";
+    std::string format = "--benchmark_out_format=json";
+    if (std::none_of(args.begin(), args.end(), [](const char *arg) {
+            return std::string_view(arg).starts_with("--benchmark_out=");
+        })) {
+        args.push_back(out.data());
+        args.push_back(format.data());
+    }
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::AddCustomContext("seed", std::to_string(Seed));
+    benchmark::AddCustomContext("keys", std::to_string(NUM_KEYS));
+
+    for (auto dataset : {Dataset::DenseInt, Dataset::SparseInt, Dataset::Url, Dataset::Email}) {
+        register_index<ArtIndex>(dataset);
+        register_index<MapIndex>(dataset);
+        register_index<HashIndex>(dataset);
+        register_index<SortedVectorIndex>(dataset);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/concurrent_adaptive_radix_tree.hpp"
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+static constexpr size_t NUM_KEYS = 1000000;
+static constexpr int MAX_THREADS = 16;
+
+static const std::vector<std::string> &keys() {
+    static const std::vector<std::string> keys = [] {
+        std::hash<uint64_t> hasher;
+        std::mt19937 rng(0);
+        std::vector<std::string> result;
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            result.push_back(std::to_string(hasher(rng())));
+        }
+        return result;
+    }();
+    return keys;
+}
+
+// baseline: the single threaded tree behind a reader/writer lock
+struct SharedMutexTree {
+    void insert(std::string_view key, int value) {
+        std::unique_lock lock(mutex);
+        tree.insert(key, value);
+    }
+
+    std::optional<int> search(std::string_view key) {
+        std::shared_lock lock(mutex);
+        return tree.search(key);
+    }
+
+    std::shared_mutex mutex;
+    AdaptiveRadixTree<int> tree;
+};
+
+template <typename Tree> static Tree *shared_tree = nullptr;
+
+// Every thread searches the same prefilled tree, write_percent of the operations insert
+// instead and overwrite an existing key.
+template <typename Tree> static void BM_Mixed(benchmark::State &state) {
+    const auto &all = keys();
+    if (state.thread_index() == 0) {
+        shared_tree<Tree> = new Tree;
+        for (size_t i = 0; i < all.size(); i++) {
+            shared_tree<Tree>->insert(all[i], static_cast<int>(i));
+        }
+    }
+    auto write_percent = static_cast<uint32_t>(state.range(0));
+    std::mt19937 rng(state.thread_index());
+    for (auto _ : state) {
+        uint32_t r = rng();
+        const auto &key = all[r % all.size()];
+        if (r % 100 < write_percent) {
+            shared_tree<Tree>->insert(key, static_cast<int>(r));
+        } else {
+            benchmark::DoNotOptimize(shared_tree<Tree>->search(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete shared_tree<Tree>;
+        shared_tree<Tree> = nullptr;
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Mixed, ConcurrentAdaptiveRadixTree<int>)
+    ->ArgName("write%")
+    ->Arg(0)
+    ->Arg(10)
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Mixed, SharedMutexTree)
+    ->ArgName("write%")
+    ->Arg(0)
+    ->Arg(10)
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,221 @@
+#include <benchmark/benchmark.h>
+
+#include "http/http_server.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+#include "utils/histogram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+
+// End to end HttpServer<EPollLoop> throughput and latency. The server runs in-process on its
+// own threads, coroutine clients on the benchmark thread's loop talk to it over loopback.
+// Arguments are connections, pipelining depth, response body bytes and keep-alive. Every
+// iteration sends up to MaxRequests requests spread over the connections, fewer for large
+// bodies. Latency is measured from writing a request to parsing its response.
+
+using namespace co_io;
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t MaxRequests = 20000;
+static constexpr size_t MinRequests = 1000;
+static constexpr size_t BytesPerIteration = size_t{1} << 28;
+static constexpr unsigned ServerThreads = 1;
+
+static AddressSolver::Address local_address(int fd) {
+    AddressSolver::Address addr;
+    system_call(::getsockname(fd, &addr.addr_, &addr.len_)).execption("getsockname");
+    return addr;
+}
+
+// port of the shared server, started on first use
+static const AddressSolver::Address &server_address() {
+    static AddressSolver::Address address = [] {
+        // the kernel picks a free port, the server binds it again once this socket is gone
+        AddressSolver any{"127.0.0.1", "0"};
+        AddressSolver::Address addr;
+        {
+            FileDescriptor probe(AsyncFile::create_listen(any.get_address_info()));
+            addr = local_address(probe.fd());
+        }
+        auto port = std::to_string(ntohs(reinterpret_cast<sockaddr_in &>(addr.addr_).sin_port));
+        std::thread([port] {
+            HttpServer<EPollLoop> server("127.0.0.1", port);
+            server.with_threads(ServerThreads);
+            server.route().route("/body", HttpMethod::GET, [](HttpRequest req) -> HttpResponse {
+                HttpResponse res{200};
+                res.headers["Connection"] = req.keep_alive() ? "keep-alive" : "close";
+                res.body.assign(std::stoul(req.args["size"]), 'x');
+                return res;
+            });
+            server.start();
+        }).detach();
+
+        // wait until the listener is up
+        for (int i = 0; i < 1000; i++) {
+            FileDescriptor test(system_call(::socket(AF_INET, SOCK_STREAM, 0)).execption("socket"));
+            if (::connect(test.fd(), &addr.addr_, addr.len_) == 0) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return addr;
+    }();
+    return address;
+}
+
+struct Load {
+    size_t connections;
+    size_t depth;
+    size_t body;
+    bool keep_alive;
+};
+
+struct Results {
+    Histogram latency;
+    size_t completed = 0;
+    size_t errors = 0;
+    size_t bytes = 0;
+};
+
+// Cuts complete responses off the front of data, returns how many there were. The server
+// always sends Content-Length.
+static size_t take_responses(std::string &data, size_t &bytes) {
+    size_t count = 0;
+    size_t offset = 0;
+    while (true) {
+        auto end = data.find("\r\n\r\n", offset);
+        if (end == std::string::npos) {
+            break;
+        }
+        auto field = data.find("Content-Length: ", offset);
+        if (field == std::string::npos || field > end) {
+            break;
+        }
+        size_t length = std::stoul(data.substr(field + 16, data.find('\r', field) - field - 16));
+        if (data.size() < end + 4 + length) {
+            break;
+        }
+        offset = end + 4 + length;
+        count += 1;
+    }
+    bytes += offset;
+    data.erase(0, offset);
+    return count;
+}
+
+static Task<Execpted<int>> open_connection(LoopBase &loop, AsyncFile &file) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    file = AsyncFile::adopt(system_call(fd).execption("socket"), &loop);
+    co_return co_await file.async_connect(server_address());
+}
+
+// Sends requests in batches of depth, the next batch goes out once all of them got answered.
+// Without keep-alive every request gets its own connection.
+static Task<void> client(LoopBase &loop, const Load &load, size_t requests, Results &results,
+                         size_t &running) {
+    std::string request = "GET /body?size=" + std::to_string(load.body) +
+                          " HTTP/1.1\r\nHost: localhost\r\nConnection: " +
+                          (load.keep_alive ? "keep-alive" : "close") + "\r\n\r\n";
+    size_t depth = load.keep_alive ? load.depth : 1;
+    AsyncFile file;
+    ChainBuffer out(*loop.buffers());
+    ChainBuffer in(*loop.buffers());
+    std::string pending;
+    std::deque<Clock::time_point> sent;
+
+    while (requests > 0) {
+        if (file.fd() == -1 && (co_await open_connection(loop, file)).is_error()) {
+            results.errors += requests;
+            break;
+        }
+        size_t batch = std::min(depth, requests);
+        for (size_t i = 0; i < batch; i++) {
+            out.append(request);
+        }
+        auto now = Clock::now();
+        sent.insert(sent.end(), batch, now);
+        bool failed = (co_await file.async_writev(out)).is_error();
+        while (!failed && !sent.empty()) {
+            auto ret = co_await file.async_read(in);
+            if (ret.is_error() || ret.value() == 0) {
+                failed = true;
+                break;
+            }
+            while (!in.empty()) {
+                pending.append(in.front());
+                in.consume(in.front().size());
+            }
+            auto done = take_responses(pending, results.bytes);
+            now = Clock::now();
+            for (; done > 0; done--) {
+                results.latency.record(static_cast<uint64_t>((now - sent.front()).count()));
+                sent.pop_front();
+                results.completed += 1;
+            }
+        }
+        if (failed) {
+            results.errors += sent.size();
+            sent.clear();
+            pending.clear();
+            out.clear();
+        }
+        requests -= batch;
+        if (failed || !load.keep_alive) {
+            file = AsyncFile();
+        }
+    }
+    if (--running == 0) {
+        loop.stop();
+    }
+}
+
+static void BM_HttpLoopback(benchmark::State &state) {
+    Load load{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(2)), state.range(3) != 0};
+    server_address();
+    size_t requests = std::clamp(BytesPerIteration / std::max<size_t>(load.body, 1), MinRequests,
+                                 MaxRequests);
+    Results results;
+    for (auto _ : state) {
+        // a fresh loop per iteration, stop() is final
+        EPollLoop loop;
+        size_t running = load.connections;
+        for (size_t i = 0; i < load.connections; i++) {
+            size_t share = requests / load.connections + (i < requests % load.connections ? 1 : 0);
+            run_task(client(loop, load, share, results, running));
+        }
+        loop.run();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(results.completed));
+    state.SetBytesProcessed(static_cast<int64_t>(results.bytes));
+    state.counters["errors"] = static_cast<double>(results.errors);
+    auto us = [&](double percentile) {
+        return static_cast<double>(results.latency.percentile(percentile)) / 1000;
+    };
+    state.counters["p50_us"] = us(50);
+    state.counters["p99_us"] = us(99);
+    state.counters["p999_us"] = us(99.9);
+    state.counters["max_us"] = static_cast<double>(results.latency.max()) / 1000;
+}
+
+// connections, depth, body bytes, keep-alive
+BENCHMARK(BM_HttpLoopback)
+    ->ArgNames({"conns", "depth", "body", "keepalive"})
+    ->Args({1, 1, 64, 1})
+    ->Args({16, 1, 64, 1})
+    ->Args({64, 1, 64, 1})
+    ->Args({16, 8, 64, 1})
+    ->Args({64, 16, 64, 1})
+    ->Args({16, 1, 16384, 1})
+    ->Args({16, 8, 16384, 1})
+    ->Args({16, 1, 1 << 20, 1})
+    ->Args({1, 1, 64, 0})
+    ->Args({16, 1, 64, 0})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,12 +1,32 @@
 #include <benchmark/benchmark.h>
 
 #include "utils/adaptive_radix_tree.hpp"
+#include "utils/slab_pool.hpp"
+#include <algorithm>
 #include <map>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 static constexpr size_t NUM_KEYS = 1600000;
 
+// tree shape from AdaptiveRadixTree::stats() as benchmark counters
+template <typename Tree> static void report_shape(benchmark::State &state, const Tree &tree) {
+    auto stats = tree.stats();
+    state.counters["node4"] = static_cast<double>(stats.nodes[0]);
+    state.counters["node16"] = static_cast<double>(stats.nodes[1]);
+    state.counters["node48"] = static_cast<double>(stats.nodes[2]);
+    state.counters["node256"] = static_cast<double>(stats.nodes[3]);
+    state.counters["avg_depth"] = stats.avg_depth;
+    state.counters["max_depth"] = static_cast<double>(stats.max_depth);
+    state.counters["fill"] = stats.fill_factor;
+    auto leaves = static_cast<double>(std::max<size_t>(stats.leaves, 1));
+    state.counters["bytes_per_key"] = static_cast<double>(stats.total_bytes()) / leaves;
+    state.counters["node_bytes_per_key"] = static_cast<double>(stats.node_bytes) / leaves;
+    state.counters["prefix_bytes"] = static_cast<double>(stats.prefix_bytes);
+    state.counters["key_bytes"] = static_cast<double>(stats.key_bytes);
+}
+
 static void BM_AdaptiveRadixTree(benchmark::State &state) {
     AdaptiveRadixTree<int> tree;
     std::hash<uint64_t> hasher;
@@ -16,15 +36,182 @@ static void BM_AdaptiveRadixTree(benchmark::State &state) {
         tree.insert(std::to_string(hasher(rng())), count);
         count += 1;
     }
+}
+
+BENCHMARK(BM_AdaptiveRadixTree)->Iterations(NUM_KEYS);
 
-    std::optional<int> result;
-    std::mt19937 rng2(0);
+// build and destroy a whole tree per iteration, compares the node allocation policies
+template <template <typename> class NodePool>
+static void BM_AdaptiveRadixTreeBuild(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys.push_back(std::to_string(hasher(rng())));
+    }
     for (auto _ : state) {
-        result = tree.search(std::to_string(hasher(rng2())));
+        AdaptiveRadixTree<int, NodePool> tree;
+        int count = 0;
+        for (const auto &key : keys) {
+            tree.insert(key, count);
+            count += 1;
+        }
+        benchmark::DoNotOptimize(tree);
     }
 }
 
-BENCHMARK(BM_AdaptiveRadixTree)->Iterations(NUM_KEYS);
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeBuild, HeapPool)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeBuild, SlabPool)->Unit(benchmark::kMillisecond);
+
+// same keys pre-sorted, bulk_load with state.range(0) threads
+template <template <typename> class NodePool>
+static void BM_AdaptiveRadixTreeBulkLoad(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    std::vector<std::pair<std::string, int>> sorted;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        sorted.emplace_back(std::to_string(hasher(rng())), static_cast<int>(i));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    for (auto _ : state) {
+        AdaptiveRadixTree<int, NodePool> tree;
+        tree.bulk_load(sorted.begin(), sorted.end(), static_cast<size_t>(state.range(0)));
+        benchmark::DoNotOptimize(tree);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeBulkLoad, HeapPool)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeBulkLoad, SlabPool)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// small range query: seek with lower_bound, then read the next state.range(0) keys
+static void BM_AdaptiveRadixTreeRange(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    AdaptiveRadixTree<int> tree;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        tree.insert(std::to_string(hasher(rng())), static_cast<int>(i));
+    }
+    auto limit = state.range(0);
+    for (auto _ : state) {
+        int sum = 0;
+        auto it = tree.lower_bound(std::to_string(hasher(rng())));
+        for (int64_t i = 0; i < limit && it != tree.end(); i++, ++it) {
+            sum += it->value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+BENCHMARK(BM_AdaptiveRadixTreeRange)->Arg(10)->Arg(100);
+
+// point lookups of state.range(0) random present keys, one by one or with search_batch
+template <bool Batch> static void BM_AdaptiveRadixTreeLookup(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    AdaptiveRadixTree<int> tree;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys.push_back(std::to_string(hasher(rng())));
+        tree.insert(keys.back(), static_cast<int>(i));
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    auto batch = static_cast<size_t>(state.range(0));
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::vector<int *> results(batch);
+    size_t offset = 0;
+    for (auto _ : state) {
+        std::span<const std::string_view> lookup(views.data() + offset, batch);
+        if constexpr (Batch) {
+            tree.search_batch(lookup, results);
+            benchmark::DoNotOptimize(results.data());
+        } else {
+            int found = 0;
+            for (const auto &key : lookup) {
+                found += tree.search(key).has_value();
+            }
+            benchmark::DoNotOptimize(found);
+        }
+        offset = offset + 2 * batch > views.size() ? 0 : offset + batch;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+}
+
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeLookup, false)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeLookup, true)->Arg(1024);
+
+// full ordered scan, dominated by iterator stepping
+static void BM_AdaptiveRadixTreeScan(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    AdaptiveRadixTree<int> tree;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        tree.insert(std::to_string(hasher(rng())), static_cast<int>(i));
+    }
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (const auto &leaf : tree) {
+            sum += leaf.value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(NUM_KEYS));
+    report_shape(state, tree);
+}
+
+BENCHMARK(BM_AdaptiveRadixTreeScan)->Unit(benchmark::kMillisecond);
+
+// the same random integers keyed by their decimal strings or natively as 8 byte keys
+template <bool Native> static void BM_AdaptiveRadixTreeIntegerKeys(benchmark::State &state) {
+    std::hash<uint64_t> hasher;
+    std::mt19937 rng(0);
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys.push_back(hasher(rng()));
+    }
+    for (auto _ : state) {
+        if constexpr (Native) {
+            AdaptiveRadixTree<int, HeapPool, uint64_t> tree;
+            for (size_t i = 0; i < keys.size(); i++) {
+                tree.insert(keys[i], static_cast<int>(i));
+            }
+            int found = 0;
+            for (auto key : keys) {
+                found += tree.find(key) != nullptr;
+            }
+            benchmark::DoNotOptimize(found);
+            state.PauseTiming();
+            report_shape(state, tree);
+            state.ResumeTiming();
+        } else {
+            AdaptiveRadixTree<int> tree;
+            for (size_t i = 0; i < keys.size(); i++) {
+                tree.insert(std::to_string(keys[i]), static_cast<int>(i));
+            }
+            int found = 0;
+            for (auto key : keys) {
+                found += tree.find(std::to_string(key)) != nullptr;
+            }
+            benchmark::DoNotOptimize(found);
+            state.PauseTiming();
+            report_shape(state, tree);
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(NUM_KEYS));
+}
+
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeIntegerKeys, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_AdaptiveRadixTreeIntegerKeys, true)->Unit(benchmark::kMillisecond);
 
 static void BM_unordered_map(benchmark::State &state) {
     std::unordered_map<std::string, int> tree;
@@ -36,14 +223,6 @@ static void BM_unordered_map(benchmark::State &state) {
         tree[std::to_string(hasher(rng()))] = count;
         count += 1;
     }
-
-    int result;
-    (void)result;
-    std::mt19937 rng2(0);
-    for (auto _ : state) {
-        // tree.find(std::to_string(hasher(rng2())));
-        result = tree[std::to_string(hasher(rng2()))];
-    }
 }
 
 BENCHMARK(BM_unordered_map)->Iterations(NUM_KEYS);
@@ -58,14 +237,6 @@ static void BM_map(benchmark::State &state) {
         tree[std::to_string(hasher(rng()))] = count;
         count += 1;
     }
-
-    int result = 0;
-    (void)result;
-    std::mt19937 rng2(0);
-    for (auto _ : state) {
-        // tree.at(std::to_string(hasher(rng2())));
-        result = tree[std::to_string(hasher(rng2()))];
-    }
 }
 
 BENCHMARK(BM_map)->Iterations(NUM_KEYS);
@@ -31,7 +31,7 @@ Task<void> server(AsyncFile &async_file) {
         std::cerr << "accept" << std::endl;
         auto t = co_await async_file.async_accept(addr);
         int fd = t.value();
-        run_task(client(AsyncFile{fd, loop.get(), 0}));
+        run_task(client(AsyncFile::adopt(fd, loop.get())));
     }
 }
 
@@ -2,9 +2,14 @@
 #include "io/loop.hpp"
 #include <string>
 
-int main() {
+int main(int argc, char *argv[]) {
     co_io::HttpServer<co_io::EPollLoop> http("localhost", "12345");
-    http.with_threads(8);
+    http.with_threads(8).with_metrics();
+    if (argc > 1 && argv[1] == std::string("acceptor")) {
+        http.with_dispatch(co_io::Dispatch::Acceptor);
+    } else if (argc > 1 && argv[1] == std::string("cpu")) {
+        http.with_dispatch(co_io::Dispatch::ReusePortCpu);
+    }
     // co_io::HttpServer<co_io::SelectLoop> http("localhost", "12345");
     http.route().route("/", co_io::HttpMethod::GET,
                        [](co_io::HttpRequest req) -> co_io::HttpResponse {
@@ -3,8 +3,10 @@
 #include <coroutine>
 #include <exception>
 #include <iostream>
+#include <source_location>
 #include <utility>
 
+#include "coroutine/trace.hpp"
 #include "utils/uninitialized.hpp"
 
 namespace co_io {
@@ -52,6 +54,11 @@ template <typename T = void> struct Promise {
     std::coroutine_handle<> previous_handle_;
     std::exception_ptr exception_;
     Uninitialized<T> result_;
+    [[no_unique_address]] TraceFrame trace_;
+
+    // where is the coroutine's function, see TraceFrame
+    Promise(std::source_location where = std::source_location::current())
+        : trace_(std::coroutine_handle<Promise>::from_promise(*this).address(), where) {}
 
     auto get_return_object() { return std::coroutine_handle<Promise>::from_promise(*this); }
 
@@ -75,6 +82,10 @@ template <typename T = void> struct Promise {
 template <> struct Promise<void> {
     std::coroutine_handle<> previous_handle_;
     std::exception_ptr result_;
+    [[no_unique_address]] TraceFrame trace_;
+
+    Promise(std::source_location where = std::source_location::current())
+        : trace_(std::coroutine_handle<Promise>::from_promise(*this).address(), where) {}
 
     auto get_return_object() { return std::coroutine_handle<Promise>::from_promise(*this); }
 
@@ -121,16 +132,20 @@ template <typename T, typename P = Promise<T>> class Task {
 
     struct Awaiter {
         std::coroutine_handle<promise_type> handle_;
+        [[no_unique_address]] TraceAwait trace_{};
 
         [[nodiscard]] bool await_ready() const noexcept { return false; }
 
-        std::coroutine_handle<promise_type>
-        await_suspend(std::coroutine_handle<> h) const noexcept {
+        std::coroutine_handle<promise_type> await_suspend(std::coroutine_handle<> h) noexcept {
+            trace_.suspend(h, trace::Wait::Task, handle_.promise().trace_.name());
             handle_.promise().previous_handle_ = h;
             return handle_;
         }
 
-        T await_resume() const { return handle_.promise().result(); }
+        T await_resume() const {
+            trace_.resume();
+            return handle_.promise().result();
+        }
     };
 
     Awaiter operator co_await() const noexcept { return {handle_}; }
@@ -148,6 +163,12 @@ template <typename T, typename P = Promise<T>> class Task {
 };
 
 struct AutoDestoryPromise {
+    [[no_unique_address]] TraceFrame trace_;
+
+    AutoDestoryPromise(std::source_location where = std::source_location::current())
+        : trace_(std::coroutine_handle<AutoDestoryPromise>::from_promise(*this).address(),
+                 where) {}
+
     struct AutoDestoryAwaiter {
         [[nodiscard]] bool await_ready() const noexcept { return false; }
         void await_suspend(std::coroutine_handle<> handle) noexcept {
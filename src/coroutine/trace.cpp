@@ -0,0 +1,216 @@
+#include "coroutine/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace co_io::trace {
+
+namespace {
+
+constexpr size_t RingEvents = size_t{1} << 16;
+
+struct Ring {
+    std::vector<Event> events = std::vector<Event>(RingEvents);
+    size_t next = 0; // total recorded, the slot is next % RingEvents
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        size_t first = next > RingEvents ? next - RingEvents : 0;
+        for (size_t i = first; i < next; i++) {
+            fn(events[i % RingEvents]);
+        }
+    }
+};
+
+// rings outlive their threads, so a loop can be traced and dumped after it exited
+std::mutex rings_mutex;
+std::vector<std::shared_ptr<Ring>> rings;
+
+Ring &local_ring() {
+    thread_local std::shared_ptr<Ring> ring = [] {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard lock(rings_mutex);
+        rings.push_back(ring);
+        return ring;
+    }();
+    return *ring;
+}
+
+const char *wait_name(Wait wait) {
+    switch (wait) {
+    case Wait::Task:
+        return "task";
+    case Wait::Read:
+        return "read";
+    case Wait::Write:
+        return "write";
+    case Wait::Timer:
+        return "timer";
+    default:
+        return "none";
+    }
+}
+
+// what a Suspend event waits on, without the fd or timer id so sites can be summed up
+std::string awaited(const Event &event) {
+    if (event.wait == Wait::Task && event.name) {
+        return event.name;
+    }
+    return wait_name(event.wait);
+}
+
+std::string escape(const std::string &text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+// chrome wants microseconds, printed with ns precision
+std::string micros(uint64_t ns) {
+    std::string fraction = std::to_string(ns % 1000);
+    return std::to_string(ns / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+}
+
+struct Interval {
+    size_t coroutine; // index into the coroutines of replay()
+    const Event *suspend;
+    uint64_t end_ns;
+};
+
+struct Replay {
+    std::vector<const char *> coroutines; // function of each coroutine seen, in order
+    std::vector<Interval> intervals;
+};
+
+// Pairs every Suspend with the next Resume of the same frame. Frames are reused once a
+// coroutine finished, so a Create starts a new coroutine at that address.
+Replay replay(const Ring &ring) {
+    Replay out;
+    std::unordered_map<const void *, size_t> frames;
+    std::unordered_map<const void *, const Event *> suspended;
+    auto coroutine = [&](const void *frame, const char *name) {
+        auto [it, added] = frames.try_emplace(frame, out.coroutines.size());
+        if (added) {
+            out.coroutines.push_back(name ? name : "unknown"); // created before the ring
+        }
+        return it->second;
+    };
+    ring.for_each([&](const Event &event) {
+        switch (event.kind) {
+        case Kind::Create:
+            frames.erase(event.frame);
+            suspended.erase(event.frame);
+            coroutine(event.frame, event.name);
+            break;
+        case Kind::Suspend:
+            suspended[event.frame] = &event;
+            break;
+        case Kind::Resume:
+            if (auto it = suspended.find(event.frame); it != suspended.end()) {
+                out.intervals.push_back(
+                    {coroutine(event.frame, nullptr), it->second, event.ns});
+                suspended.erase(it);
+            }
+            break;
+        }
+    });
+    return out;
+}
+
+std::vector<std::shared_ptr<Ring>> all_rings() {
+    std::lock_guard lock(rings_mutex);
+    return rings;
+}
+
+} // namespace
+
+void record(Kind kind, Wait wait, const void *frame, const char *name, int64_t arg) noexcept {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch())
+                  .count();
+    auto &ring = local_ring();
+    ring.events[ring.next % RingEvents] = {static_cast<uint64_t>(ns), frame, name, arg, kind, wait};
+    ring.next += 1;
+}
+
+void dump_chrome(std::ostream &out) {
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&] {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+    size_t base = 0; // track ids of all rings are distinct
+    auto rings = all_rings();
+    for (size_t r = 0; r < rings.size(); r++) {
+        auto trace = replay(*rings[r]);
+        for (size_t i = 0; i < trace.coroutines.size(); i++) {
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << r << ",\"tid\":"
+                << base + i << ",\"args\":{\"name\":\"" << escape(trace.coroutines[i]) << "\"}}";
+        }
+        for (const auto &interval : trace.intervals) {
+            const Event &suspend = *interval.suspend;
+            separator();
+            out << "{\"ph\":\"X\",\"name\":\"" << escape(awaited(suspend)) << "\",\"pid\":" << r
+                << ",\"tid\":" << base + interval.coroutine << ",\"ts\":" << micros(suspend.ns)
+                << ",\"dur\":" << micros(interval.end_ns - suspend.ns);
+            if (suspend.wait != Wait::Task) {
+                out << ",\"args\":{\"" << wait_name(suspend.wait) << "\":" << suspend.arg << "}";
+            }
+            out << "}";
+        }
+        base += trace.coroutines.size();
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void dump_summary(std::ostream &out) {
+    struct Site {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+    };
+    std::map<std::pair<std::string, std::string>, Site> sites;
+    for (const auto &ring : all_rings()) {
+        auto trace = replay(*ring);
+        for (const auto &interval : trace.intervals) {
+            auto &site =
+                sites[{trace.coroutines[interval.coroutine], awaited(*interval.suspend)}];
+            uint64_t ns = interval.end_ns - interval.suspend->ns;
+            site.count += 1;
+            site.total_ns += ns;
+            site.max_ns = std::max(site.max_ns, ns);
+        }
+    }
+    std::vector<std::pair<const std::pair<std::string, std::string> *, Site>> sorted;
+    for (const auto &[key, site] : sites) {
+        sorted.emplace_back(&key, site);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto &a, const auto &b) { return a.second.total_ns > b.second.total_ns; });
+    out << "total_us\tcount\tmean_us\tmax_us\tcoroutine -> awaited\n";
+    for (const auto &[key, site] : sorted) {
+        out << site.total_ns / 1000 << "\t" << site.count << "\t"
+            << site.total_ns / site.count / 1000 << "\t" << site.max_ns / 1000 << "\t"
+            << key->first << " -> " << key->second << "\n";
+    }
+}
+
+void clear() {
+    for (const auto &ring : all_rings()) {
+        ring->next = 0;
+    }
+}
+
+} // namespace co_io::trace
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <ostream>
+#include <source_location>
+
+// Coroutine tracing, compiled in with -DCO_IO_TRACE (the CO_IO_TRACE cmake option). It changes
+// the layout of every promise, so the whole program has to be built with the same setting.
+// Without it the hooks below are empty members and calls the compiler drops.
+
+namespace co_io {
+
+#ifdef CO_IO_TRACE
+inline constexpr bool TraceEnabled = true;
+#else
+inline constexpr bool TraceEnabled = false;
+#endif
+
+namespace trace {
+
+enum class Kind : uint8_t { Create, Suspend, Resume };
+enum class Wait : uint8_t { None, Task, Read, Write, Timer };
+
+struct Event {
+    uint64_t ns;       // steady clock
+    const void *frame; // the coroutine that was created, suspended or resumed
+    const char *name;  // Create: its function, Suspend on a Task: the awaited function
+    int64_t arg;       // Suspend: fd or timer id
+    Kind kind;
+    Wait wait;
+};
+
+// Appends to the calling thread's ring, the oldest events are overwritten once it is full.
+void record(Kind kind, Wait wait, const void *frame, const char *name, int64_t arg) noexcept;
+
+// The readers walk the rings of all threads, so call them once the traced loops stopped or
+// from the only thread that records.
+
+// Chrome trace event JSON (chrome://tracing, Perfetto): one track per coroutine, named by its
+// function, with a slice for every time it was suspended labelled by what it waited on.
+void dump_chrome(std::ostream &out);
+// Time spent suspended per await site, a coroutine function and what it awaited, the site
+// with the most total time first.
+void dump_summary(std::ostream &out);
+void clear();
+
+} // namespace trace
+
+// member of every traced promise, records the creation of its coroutine
+class TraceFrame {
+  public:
+#ifdef CO_IO_TRACE
+    TraceFrame(const void *frame, std::source_location where) : name_(where.function_name()) {
+        trace::record(trace::Kind::Create, trace::Wait::None, frame, name_, 0);
+    }
+    const char *name() const noexcept { return name_; }
+
+  private:
+    const char *name_;
+#else
+    constexpr TraceFrame(const void *, std::source_location) noexcept {}
+    constexpr const char *name() const noexcept { return nullptr; }
+#endif
+};
+
+// member of every traced awaiter, records when the awaiting coroutine suspends and resumes
+class TraceAwait {
+  public:
+#ifdef CO_IO_TRACE
+    void suspend(std::coroutine_handle<> awaiting, trace::Wait wait, const char *name = nullptr,
+                 int64_t arg = 0) noexcept {
+        frame_ = awaiting.address();
+        trace::record(trace::Kind::Suspend, wait, frame_, name, arg);
+    }
+    void resume() const noexcept {
+        trace::record(trace::Kind::Resume, trace::Wait::None, frame_, nullptr, 0);
+    }
+
+  private:
+    const void *frame_ = nullptr;
+#else
+    constexpr void suspend(std::coroutine_handle<>, trace::Wait, const char * = nullptr,
+                           int64_t = 0) noexcept {}
+    constexpr void resume() const noexcept {}
+#endif
+};
+
+} // namespace co_io
@@ -0,0 +1,255 @@
+#include "http/http_client.hpp"
+#include "coroutine/when_any.hpp"
+#include "http/http_parser.hpp"
+#include "io/async_file.hpp"
+#include "io/timer_context.hpp"
+
+#include <deque>
+#include <sys/socket.h>
+#include <system_error>
+
+namespace co_io {
+
+struct HttpClient::Pending {
+    struct Awaiter {
+        bool await_ready() const noexcept { return pending_->done; }
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            pending_->waiter = h;
+            trace_.suspend(h, trace::Wait::None);
+        }
+        void await_resume() const noexcept { trace_.resume(); }
+        // also when the waiting coroutine is destroyed because the timeout came first
+        ~Awaiter() { pending_->waiter = nullptr; }
+
+        Pending *pending_;
+        [[no_unique_address]] TraceAwait trace_{};
+    };
+
+    HttpResponse response;
+    std::error_code error;
+    std::coroutine_handle<> waiter;
+    bool done = false;
+
+    // only the first outcome counts, a request that timed out ignores its late response
+    void complete(HttpResponse res) {
+        if (!done) {
+            response = std::move(res);
+            wake();
+        }
+    }
+
+    void fail(std::error_code err) {
+        if (!done) {
+            error = err;
+            wake();
+        }
+    }
+
+  private:
+    void wake() {
+        done = true;
+        if (auto h = std::exchange(waiter, nullptr)) {
+            h.resume();
+        }
+    }
+};
+
+struct HttpClient::Connection {
+    enum class State { New, Connecting, Open, Closed };
+
+    explicit Connection(LoopBase *loop) : loop(loop), out(*loop->buffers()) {}
+
+    LoopBase *loop;
+    AsyncFile file;
+    ChainBuffer out; // requests not written yet
+    HttpResponseParser parser;
+    std::deque<std::shared_ptr<Pending>> pending; // every request without response, in order
+    State state = State::New;
+    bool writing = false;
+
+    // takes new requests
+    bool usable() const { return state != State::Closed && parser.keep_alive(); }
+
+    // No new requests. Shutting down the read side wakes read_responses, which fails what
+    // is pending, writes still go out so a writer never hits SIGPIPE from here.
+    void close() {
+        state = State::Closed;
+        if (file.fd() != -1) {
+            ::shutdown(file.fd(), SHUT_RD);
+        }
+    }
+
+    void fail(std::error_code error) {
+        state = State::Closed;
+        while (!pending.empty()) {
+            auto front = std::move(pending.front());
+            pending.pop_front();
+            front->fail(error);
+        }
+    }
+};
+
+HttpClient::~HttpClient() {
+    for (auto &[key, pool] : pools_) {
+        for (auto &conn : pool) {
+            conn->close();
+        }
+    }
+}
+
+Task<HttpResponse> HttpClient::request(std::string host, std::string port, HttpRequest req) {
+    auto conn = acquire(host, port);
+    if (!req.headers.contains("Host")) {
+        req.headers.emplace("Host", port == "80" ? host : host + ":" + port);
+    }
+    req.version = HttpVersion::HTTP_1_1;
+    req.serialize(conn->out);
+    conn->parser.expect(req.method);
+    auto pending = std::make_shared<Pending>();
+    conn->pending.push_back(pending);
+    if (conn->state == Connection::State::New) {
+        auto *resolver = options_.resolver ? options_.resolver : &Resolver::global();
+        run_task(establish(conn, host, port, resolver, options_.connect_timeout));
+    } else {
+        flush(conn);
+    }
+
+    if (options_.request_timeout.count() > 0) {
+        co_await when_any(wait_response(pending),
+                          loop_->timer()->sleep_for(options_.request_timeout));
+        if (!pending->done) {
+            pending->fail(std::error_code(ETIMEDOUT, std::system_category()));
+            conn->close();
+        }
+    } else {
+        co_await wait_response(pending);
+    }
+    if (pending->error) {
+        throw std::system_error(pending->error, "HttpClient " + host + ":" + port);
+    }
+    co_return std::move(pending->response);
+}
+
+Task<HttpResponse> HttpClient::get(std::string host, std::string port, std::string url) {
+    HttpRequest req;
+    req.method = HttpMethod::GET;
+    req.version = HttpVersion::HTTP_1_1;
+    req.url = std::move(url);
+    return request(std::move(host), std::move(port), std::move(req));
+}
+
+size_t HttpClient::connections() const {
+    size_t count = 0;
+    for (const auto &[key, pool] : pools_) {
+        for (const auto &conn : pool) {
+            count += conn->usable() ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+HttpClient::ConnectionPtr HttpClient::acquire(const std::string &host, const std::string &port) {
+    auto &pool = pools_[host + ":" + port];
+    std::erase_if(pool, [](const ConnectionPtr &conn) { return !conn->usable(); });
+    ConnectionPtr best;
+    for (const auto &conn : pool) {
+        if (!best || conn->pending.size() < best->pending.size()) {
+            best = conn;
+        }
+    }
+    if (!best || (!best->pending.empty() && pool.size() < options_.max_connections)) {
+        best = std::make_shared<Connection>(loop_);
+        pool.push_back(best);
+    }
+    return best;
+}
+
+void HttpClient::flush(const ConnectionPtr &conn) {
+    if (conn->state == Connection::State::Open && !conn->writing && !conn->out.empty()) {
+        run_task(write_requests(conn));
+    }
+}
+
+Task<void> HttpClient::establish(ConnectionPtr conn, std::string host, std::string port,
+                                 Resolver *resolver, std::chrono::milliseconds timeout) {
+    conn->state = Connection::State::Connecting;
+    Execpted<int> result;
+    try {
+        auto addresses = co_await resolver->resolve(conn->loop, host, port);
+        result = co_await AsyncFile::async_connect_any(addresses, conn->loop, timeout);
+    } catch (const std::system_error &e) { // resolving failed
+        result = Execpted<int>(e.code());
+    }
+    if (!result.is_error()) {
+        conn->file = AsyncFile::adopt(result.value(), conn->loop);
+    }
+    if (conn->state == Connection::State::Closed) { // a request timed out or the client is gone
+        conn->fail(std::error_code(ECONNABORTED, std::system_category()));
+    } else if (result.is_error()) {
+        conn->fail(result.error());
+    } else {
+        conn->state = Connection::State::Open;
+        run_task(read_responses(conn));
+        flush(conn);
+    }
+}
+
+// one at a time per connection, requests queued meanwhile are written by the same call
+Task<void> HttpClient::write_requests(ConnectionPtr conn) {
+    conn->writing = true;
+    auto ret = co_await conn->file.async_writev(conn->out);
+    conn->writing = false;
+    if (ret.is_error()) {
+        conn->close();
+    }
+}
+
+// Reads until the connection ends, also while it is idle, so a pooled connection the
+// server closed is dropped before a request is queued on it.
+Task<void> HttpClient::read_responses(ConnectionPtr conn) {
+    ChainBuffer buf(*conn->loop->buffers());
+    std::error_code error(ECONNRESET, std::system_category());
+    auto &responses = conn->parser.responses();
+    while (true) {
+        auto ret = co_await conn->file.async_read(buf);
+        if (ret.is_error()) {
+            error = ret.error();
+            break;
+        }
+        bool eof = ret.value() == 0;
+        auto parsed = eof ? conn->parser.finish() : Execpted<size_t>(size_t{0});
+        while (!buf.empty() && !parsed.is_error()) {
+            auto data = buf.front();
+            parsed = conn->parser.parse(data);
+            buf.consume(data.size());
+        }
+        // Resuming a request runs its caller until it waits again, which may queue more
+        // requests here, so each is taken off the queues first.
+        while (!responses.empty() && !conn->pending.empty()) {
+            auto pending = std::move(conn->pending.front());
+            conn->pending.pop_front();
+            auto res = std::move(responses.front());
+            responses.pop_front();
+            pending->complete(std::move(res));
+        }
+        if (parsed.is_error()) {
+            error = parsed.error();
+            break;
+        }
+        if (eof || !conn->parser.keep_alive()) {
+            break;
+        }
+        if (!responses.empty()) { // with no request left to answer
+            error = std::error_code(EPROTO, std::system_category());
+            break;
+        }
+    }
+    conn->close();
+    conn->fail(error);
+}
+
+Task<void> HttpClient::wait_response(std::shared_ptr<Pending> pending) {
+    co_await Pending::Awaiter{pending.get()};
+}
+
+} // namespace co_io
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "coroutine/task.hpp"
+#include "http/http_util.hpp"
+#include "io/loop.hpp"
+#include "io/resolver.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace co_io {
+
+// HTTP/1.1 client for the coroutines of one loop, use it only on that loop's thread.
+// Connections stay open after a response and are pooled per host and port. A request takes
+// an idle connection of its host, opens a new one while the host has fewer than
+// max_connections, and otherwise is pipelined behind the requests of the least busy one.
+// Failures throw std::system_error, with ETIMEDOUT when a timeout expired. A request written
+// to a connection the server just closed raises SIGPIPE, so programs using it ignore that.
+class HttpClient {
+  public:
+    struct Options {
+        size_t max_connections = 8; // per host
+        // for connecting once the name is resolved, zero waits forever
+        std::chrono::milliseconds connect_timeout{3000};
+        // from queueing the request until its whole response arrived, the connection is
+        // closed when it expires and requests pipelined behind it fail too
+        std::chrono::milliseconds request_timeout{10000};
+        Resolver *resolver = nullptr; // Resolver::global() when null
+    };
+
+    explicit HttpClient(LoopBase *loop) : HttpClient(loop, Options{}) {}
+    HttpClient(LoopBase *loop, Options options) : loop_(loop), options_(options) {}
+    // closes the connections, their requests fail once the loop runs again
+    ~HttpClient();
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    // Sends req as HTTP/1.1 with a Host header unless it has one, see HttpRequest::serialize.
+    // The response has its body decoded, without Content-Length or Transfer-Encoding.
+    Task<HttpResponse> request(std::string host, std::string port, HttpRequest req);
+    Task<HttpResponse> get(std::string host, std::string port, std::string url);
+
+    // open or connecting, of all hosts
+    size_t connections() const;
+
+  private:
+    struct Pending;
+    struct Connection;
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    LoopBase *loop_;
+    Options options_;
+    std::unordered_map<std::string, std::vector<ConnectionPtr>> pools_; // by host:port
+
+    ConnectionPtr acquire(const std::string &host, const std::string &port);
+    // starts a writer for the queued requests unless one is running
+    static void flush(const ConnectionPtr &conn);
+
+    // the tasks of a connection only hold the connection, so they outlive the client
+    static Task<void> establish(ConnectionPtr conn, std::string host, std::string port,
+                                Resolver *resolver, std::chrono::milliseconds timeout);
+    static Task<void> write_requests(ConnectionPtr conn);
+    static Task<void> read_responses(ConnectionPtr conn);
+    static Task<void> wait_response(std::shared_ptr<Pending> pending);
+};
+
+} // namespace co_io
@@ -3,28 +3,42 @@
 namespace co_io {
 
 Task<void> HttpConnection::handle() {
-    ByteBuffer buf{1024};
+    // holds segments only while a request is partly parsed, see AsyncFile::async_read
+    ChainBuffer buf(*conn_.loop()->buffers());
     while (!stop) {
         auto ret = co_await conn_.async_read(buf);
-        if (ret.is_error()) {
+        if (ret.is_error() || ret.value() == 0) {
             break;
         }
-        auto size = ret.value();
-        if (size == 0 || parser_.parse(buf.span(0, static_cast<size_t>(size))).is_error()) {
+        // the parser keeps its state between calls, so segments are fed one at a time
+        bool failed = false;
+        while (!buf.empty() && !failed) {
+            auto data = buf.front();
+            failed = parser_.parse(data).is_error();
+            buf.consume(data.size());
+        }
+        if (failed) {
             break;
         }
     }
 }
 
+// Pipelined requests complete while an earlier response is still being written, and a
+// poller keeps only one waiter per fd and direction. So responses are queued in out_ and
+// one writer at a time drains it, which also keeps them in request order.
 Task<void> HttpConnection::handle_request(HttpRequest req) {
+    close_after_write_ = close_after_write_ || !req.keep_alive();
     auto response = router_.handle(std::move(req));
-    ByteBuffer buf;
-    response.serialize(buf);
-    auto ret = co_await conn_.async_write(buf);
-    if (ret.is_error() || !req.keep_alive()) {
+    response.serialize(out_);
+    if (writing_) {
+        co_return;
+    }
+    writing_ = true;
+    auto ret = co_await conn_.async_writev(out_);
+    writing_ = false;
+    if (ret.is_error() || close_after_write_) {
         stop = true;
     }
-    co_return;
 }
 
 } // namespace co_io
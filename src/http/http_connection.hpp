@@ -4,7 +4,7 @@
 #include "http/http_parser.hpp"
 #include "http/http_router.hpp"
 #include "io/async_file.hpp"
-#include "utils/byte_buffer.hpp"
+#include "io/loop.hpp"
 
 #include <functional>
 
@@ -13,17 +13,19 @@ namespace co_io {
 class HttpConnection {
   public:
     HttpConnection(AsyncFile conn, HttpRouter &router)
-        : conn_(std::move(conn)), buffer_(1024), router_(router),
+        : conn_(std::move(conn)), out_(*conn_.loop()->buffers()), router_(router),
           parser_(std::bind(&HttpConnection::handle_request, this, std::placeholders::_1)) {}
 
     Task<void> handle();
 
   private:
     AsyncFile conn_;
-    ByteBuffer buffer_;
+    ChainBuffer out_; // responses not written yet, in request order
     HttpRouter &router_;
     HttpPraser parser_;
     bool stop = {false};
+    bool writing_ = {false};
+    bool close_after_write_ = {false};
 
     Task<void> handle_request(HttpRequest req);
 };
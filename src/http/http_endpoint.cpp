@@ -2,13 +2,13 @@
 
 namespace co_io {
 
-bool HttpEndpoint::match(const HttpRequest &req) {
+bool HttpEndpoint::match(const HttpRequest &req) const {
     if (req.method != method_) {
         return false;
     }
 
     if (regex_) {
-        return re2::RE2::FullMatch(req.url, *regex_, nullptr);
+        return re2::RE2::FullMatch(req.url, *regex_);
     }
 
     return true;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "http/http_util.hpp"
+#include "http/route_stats.hpp"
 #include "re2/re2.h"
+#include <memory>
 #include <string>
 
 namespace co_io {
@@ -9,24 +11,29 @@ namespace co_io {
 class HttpEndpoint {
   public:
     HttpEndpoint(HttpReponseCallback callback, std::string url, HttpMethod method,
-                 bool use_regex = false)
-        : callback_(std::move(callback)), url_(std::move(url)), method_(method) {
+                 bool use_regex = false, std::shared_ptr<RouteStats> stats = nullptr)
+        : callback_(std::move(callback)), url_(std::move(url)), method_(method),
+          stats_(std::move(stats)) {
         if (use_regex) {
             regex_ = std::make_shared<re2::RE2>(url_);
         }
     }
 
-    bool match(const HttpRequest &req);
+    bool match(const HttpRequest &req) const;
 
     bool ok() const { return regex_ == nullptr || regex_->ok(); }
 
-    HttpResponse operator()(HttpRequest req) { return callback_(std::move(req)); }
+    HttpResponse operator()(HttpRequest req) const { return callback_(std::move(req)); }
+
+    // shared by the copies in every published version of the route tables
+    RouteStats *stats() const { return stats_.get(); }
 
   private:
     HttpReponseCallback callback_;
     std::string url_;
     enum HttpMethod method_;
     std::shared_ptr<re2::RE2> regex_;
+    std::shared_ptr<RouteStats> stats_;
 };
 
 } // namespace co_io
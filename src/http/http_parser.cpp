@@ -3,6 +3,7 @@
 #include <iostream>
 #include <ostream>
 #include <stdexcept>
+#include <strings.h>
 
 namespace co_io {
 namespace {} // namespace
@@ -26,6 +27,11 @@ HttpPraser::HttpPraser(CallbackRequest on_request_complete)
     settings_.on_header_field = HttpPraser::on_header_field;
     settings_.on_header_value = HttpPraser::on_header_value;
     settings_.on_body = HttpPraser::on_body;
+
+    settings_.on_url_complete = HttpPraser::on_url_complete;
+    settings_.on_method_complete = HttpPraser::on_method_complete;
+    settings_.on_version_complete = HttpPraser::on_version_complete;
+    settings_.on_header_value_complete = HttpPraser::on_header_value_complete;
 }
 
 HttpPraser::~HttpPraser() { llhttp_finish(&parser_); }
@@ -47,6 +53,9 @@ Execpted<size_t> HttpPraser::parse(std::string_view data) {
 
 int HttpPraser::on_message_complete(llhttp_t *parser) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    // the delimiters: two spaces and CRLF in the request line, ": " and CRLF per header line
+    // and the empty line
+    p->req.size += 4 + 4 * p->req.headers.size() + 2;
     if (parser->content_length == 0) {
         run_task(p->on_request_complete_(std::move(p->req)));
     } else {
@@ -62,19 +71,43 @@ int HttpPraser::on_message_complete(llhttp_t *parser) {
 
 int HttpPraser::on_url(llhttp_t *parser, const char *at, size_t length) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
-    p->req.set_url(std::string_view(at, length));
+    p->url_.append(at, length);
+    p->req.size += length;
+    return 0;
+}
+
+int HttpPraser::on_url_complete(llhttp_t *parser) {
+    HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    p->req.set_url(p->url_);
+    p->url_.clear();
     return 0;
 }
 
 int HttpPraser::on_method(llhttp_t *parser, const char *at, size_t length) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
-    p->req.set_http_method(std::string_view(at, length));
+    p->method_.append(at, length);
+    p->req.size += length;
+    return 0;
+}
+
+int HttpPraser::on_method_complete(llhttp_t *parser) {
+    HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    p->req.set_http_method(p->method_);
+    p->method_.clear();
     return 0;
 }
 
 int HttpPraser::on_version(llhttp_t *parser, const char *at, size_t length) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
-    p->req.set_http_version(std::string_view(at, length));
+    p->version_.append(at, length);
+    p->req.size += length;
+    return 0;
+}
+
+int HttpPraser::on_version_complete(llhttp_t *parser) {
+    HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    p->req.set_http_version(p->version_);
+    p->version_.clear();
     return 0;
 }
 
@@ -86,22 +119,34 @@ int HttpPraser::on_status(llhttp_t *, const char *, size_t) {
 
 int HttpPraser::on_header_field(llhttp_t *parser, const char *at, size_t length) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
-    p->last_header_field = std::string(at, length);
+    p->last_header_field.append(at, length);
+    p->req.size += length;
     return 0;
 }
 
 int HttpPraser::on_header_value(llhttp_t *parser, const char *at, size_t length) {
+    HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    p->last_header_value.append(at, length);
+    p->req.size += length;
+    return 0;
+}
+
+int HttpPraser::on_header_value_complete(llhttp_t *parser) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
     if (p->last_header_field.empty()) {
         return -1;
     }
-    p->req.headers.insert_or_assign(std::move(p->last_header_field), std::string(at, length));
+    p->req.headers.insert_or_assign(std::move(p->last_header_field),
+                                    std::move(p->last_header_value));
+    p->last_header_field.clear();
+    p->last_header_value.clear();
     return 0;
 }
 
 int HttpPraser::on_body(llhttp_t *parser, const char *at, size_t length) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
     p->req.body.append(at, length);
+    p->req.size += length;
     if (p->req.body.size() == p->content_length) {
         run_task(p->on_request_complete_(std::move(p->req)));
     }
@@ -110,10 +155,93 @@ int HttpPraser::on_body(llhttp_t *parser, const char *at, size_t length) {
 
 int HttpPraser::on_reset(llhttp_t *parser) {
     HttpPraser *p = static_cast<HttpPraser *>(parser->data);
+    p->url_.clear();
+    p->method_.clear();
+    p->version_.clear();
     p->last_header_field.clear();
+    p->last_header_value.clear();
     p->req.clear();
     p->content_length = 0;
     return 0;
 }
 
+HttpResponseParser::HttpResponseParser() {
+    llhttp_settings_init(&settings_);
+    llhttp_init(&parser_, HTTP_RESPONSE, &settings_);
+    parser_.data = this;
+
+    settings_.on_header_field = HttpResponseParser::on_header_field;
+    settings_.on_header_value = HttpResponseParser::on_header_value;
+    settings_.on_body = HttpResponseParser::on_body;
+    settings_.on_header_value_complete = HttpResponseParser::on_header_value_complete;
+    settings_.on_headers_complete = HttpResponseParser::on_headers_complete;
+    settings_.on_message_complete = HttpResponseParser::on_message_complete;
+}
+
+Execpted<size_t> HttpResponseParser::result(llhttp_errno_t error, size_t size) {
+    if (error == HPE_OK) {
+        return Execpted{size};
+    }
+    return Execpted<size_t>(std::error_code{error, http_parser_category()});
+}
+
+Execpted<size_t> HttpResponseParser::parse(std::string_view data) {
+    return result(llhttp_execute(&parser_, data.data(), data.size()), data.size());
+}
+
+Execpted<size_t> HttpResponseParser::finish() { return result(llhttp_finish(&parser_), 0); }
+
+int HttpResponseParser::on_header_field(llhttp_t *parser, const char *at, size_t length) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    p->last_header_field.append(at, length);
+    return 0;
+}
+
+int HttpResponseParser::on_header_value(llhttp_t *parser, const char *at, size_t length) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    p->last_header_value.append(at, length);
+    return 0;
+}
+
+int HttpResponseParser::on_header_value_complete(llhttp_t *parser) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    const char *field = p->last_header_field.c_str();
+    // the body is stored decoded, see HttpResponse::serialize for the length it is sent with
+    if (::strcasecmp(field, "Content-Length") != 0 &&
+        ::strcasecmp(field, "Transfer-Encoding") != 0) {
+        p->res.headers.insert_or_assign(std::move(p->last_header_field),
+                                        std::move(p->last_header_value));
+    }
+    p->last_header_field.clear();
+    p->last_header_value.clear();
+    return 0;
+}
+
+int HttpResponseParser::on_headers_complete(llhttp_t *parser) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    p->res.status = parser->status_code;
+    // 1 tells llhttp the response has no body whatever its headers say
+    return !p->methods_.empty() && p->methods_.front() == HttpMethod::HEAD ? 1 : 0;
+}
+
+int HttpResponseParser::on_body(llhttp_t *parser, const char *at, size_t length) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    p->res.body.append(at, length);
+    return 0;
+}
+
+int HttpResponseParser::on_message_complete(llhttp_t *parser) {
+    auto *p = static_cast<HttpResponseParser *>(parser->data);
+    // 1xx responses are interim, the final response to the request follows
+    if (p->res.status >= 200) {
+        if (!p->methods_.empty()) {
+            p->methods_.pop_front();
+        }
+        p->keep_alive_ = p->keep_alive_ && llhttp_should_keep_alive(parser);
+        p->responses_.push_back(std::move(p->res));
+    }
+    p->res = HttpResponse{};
+    return 0;
+}
+
 } // namespace co_io
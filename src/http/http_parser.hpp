@@ -5,6 +5,7 @@
 #include "llhttp.h"
 #include "utils/system_call.hpp"
 
+#include <deque>
 #include <functional>
 #include <string>
 #include <system_error>
@@ -33,7 +34,13 @@ class HttpPraser {
     CallbackRequest on_request_complete_;
     llhttp_t parser_;
     llhttp_settings_t settings_;
+    // llhttp hands out tokens in pieces when they span reads or buffer segments, they are
+    // collected here and stored in req by the *_complete callbacks
+    std::string url_ = {};
+    std::string method_ = {};
+    std::string version_ = {};
     std::string last_header_field = {};
+    std::string last_header_value = {};
     uint64_t content_length = {};
     HttpRequest req;
 
@@ -45,10 +52,55 @@ class HttpPraser {
     static int on_header_value(llhttp_t *parser, const char *at, size_t length);
     static int on_body(llhttp_t *parser, const char *at, size_t length);
 
+    static int on_url_complete(llhttp_t *parser);
+    static int on_method_complete(llhttp_t *parser);
+    static int on_version_complete(llhttp_t *parser);
+    static int on_header_value_complete(llhttp_t *parser);
+
     // static int on_headers_complete(llhttp_t *);
     static int on_message_complete(llhttp_t *);
     static int on_reset(llhttp_t *parser);
     // static int on_chunk_header(llhttp_t *parser);
     // static int on_chunk_complete(llhttp_t *parser);
 };
+
+// Parses the responses of a client connection, llhttp in HTTP_RESPONSE mode. Complete ones
+// are appended to responses() with the body decoded, so Content-Length and
+// Transfer-Encoding are not kept in their headers.
+class HttpResponseParser {
+  public:
+    HttpResponseParser();
+
+    HttpResponseParser(const HttpResponseParser &) = delete;
+    HttpResponseParser &operator=(const HttpResponseParser &) = delete;
+
+    Execpted<size_t> parse(std::string_view data);
+    // at end of stream, completes a response that is delimited by the close
+    Execpted<size_t> finish();
+    // the method of each request sent, in order: responses to HEAD have no body
+    void expect(HttpMethod method) { methods_.push_back(method); }
+
+    std::deque<HttpResponse> &responses() noexcept { return responses_; }
+    // false once a response asked to close the connection
+    bool keep_alive() const noexcept { return keep_alive_; }
+
+  private:
+    llhttp_t parser_;
+    llhttp_settings_t settings_;
+    std::string last_header_field = {};
+    std::string last_header_value = {};
+    HttpResponse res;
+    std::deque<HttpMethod> methods_;
+    std::deque<HttpResponse> responses_;
+    bool keep_alive_ = true;
+
+    static Execpted<size_t> result(llhttp_errno_t error, size_t size);
+
+    static int on_header_field(llhttp_t *parser, const char *at, size_t length);
+    static int on_header_value(llhttp_t *parser, const char *at, size_t length);
+    static int on_body(llhttp_t *parser, const char *at, size_t length);
+    static int on_header_value_complete(llhttp_t *parser);
+    static int on_headers_complete(llhttp_t *parser);
+    static int on_message_complete(llhttp_t *parser);
+};
 } // namespace co_io
@@ -2,47 +2,132 @@
 
 #include "http/http_endpoint.hpp"
 #include "http/http_util.hpp"
-#include "utils/adaptive_radix_tree.hpp"
+#include "http/route_stats.hpp"
+#include "utils/persistent_adaptive_radix_tree.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace co_io {
 
+// Routes can be added while workers handle requests: route() publishes a new version of
+// the route tables, handle() works on the version published when it started.
 class HttpRouter {
   public:
+    using SlowHandler =
+        std::function<void(const HttpRequest &req, const HttpResponse &res,
+                           std::chrono::nanoseconds elapsed)>;
+
     bool route(const std::string &url, HttpMethod method, HttpReponseCallback callback,
                bool use_regex = false) {
         std::string key = url + "_" + std::string(http_method(method));
-        HttpEndpoint end_point{std::move(callback), url, method, use_regex};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // a route added again keeps counting where the old one left off
+        auto it = stats_.find(key);
+        auto stats = it != stats_.end()
+                         ? it->second
+                         : std::make_shared<RouteStats>(url, std::string(http_method(method)));
+        HttpEndpoint end_point{std::move(callback), url, method, use_regex, stats};
         if (!end_point.ok()) {
             return false;
         }
+        stats_.emplace(key, std::move(stats));
 
-        if (!use_regex) {
-            match_routes_.insert(key, std::move(end_point));
-        } else {
-            regex_routes_.insert(key, std::move(end_point));
-        }
+        auto &routes = use_regex ? regex_routes_ : match_routes_;
+        routes.insert(key, std::move(end_point));
+        routes.publish();
         return true;
     }
 
+    // The tables are borrowed rather than referenced, so workers touch no shared counter.
+    // Tables replaced by a route() meanwhile are freed once the handler has returned.
     HttpResponse handle(HttpRequest req) {
         std::string key = req.url + "_" + std::string(http_method(req.method));
-        if (auto end_point = match_routes_.search(key); end_point) {
-            if ((*end_point).match(req)) {
-                return (*end_point)(std::move(req));
+        return match_routes_.with_published([&](const Routes &match_routes) {
+            if (auto *end_point = match_routes.find(key); end_point && end_point->match(req)) {
+                return call(*end_point->stats(), std::move(req), *end_point);
             }
-        }
-        for (auto &[_, end_point] : regex_routes_) {
-            if (end_point.match(req)) {
-                return end_point(std::move(req));
+            return regex_routes_.with_published([&](const Routes &regex_routes) {
+                for (const auto &leaf : regex_routes) {
+                    if (leaf.value.match(req)) {
+                        return call(*leaf.value.stats(), std::move(req), leaf.value);
+                    }
+                }
+                return call(not_found_, std::move(req), [](HttpRequest) {
+                    return HttpResponse{.status = 404, .body = "<h1>404 Not Found</h1>"}; // 404
+                });
+            });
+        });
+    }
+
+    // Handlers run on the loop thread, one that takes longer than threshold stalls every
+    // other connection of its loop. Those are counted in the route's stats and passed to
+    // on_slow, which runs on the same thread. Zero turns it off. Set before serving.
+    void slow_threshold(std::chrono::microseconds threshold, SlowHandler on_slow = log_slow) {
+        on_slow_ = std::move(on_slow);
+        slow_ns_.store(std::chrono::nanoseconds(threshold).count(), std::memory_order_relaxed);
+    }
+
+    // every route with its counters so far, requests no route matched last
+    std::vector<RouteStats::Snapshot> stats() const {
+        std::vector<RouteStats::Snapshot> routes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto &[key, stats] : stats_) {
+                routes.push_back(stats->snapshot());
             }
         }
-        return HttpResponse{.status = 404, .body = "<h1>404 Not Found</h1>"}; // 404
+        routes.push_back(not_found_.snapshot());
+        return routes;
+    }
+
+    static void log_slow(const HttpRequest &req, const HttpResponse &res,
+                         std::chrono::nanoseconds elapsed) {
+        std::cerr << "slow handler: " << http_method(req.method) << " " << req.url << " "
+                  << res.status << " took "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+                  << "us" << std::endl;
     }
 
   private:
-    AdaptiveRadixTree<HttpEndpoint> match_routes_;
-    AdaptiveRadixTree<HttpEndpoint> regex_routes_;
+    using Routes = PersistentAdaptiveRadixTree<HttpEndpoint>::View;
+
+    mutable std::mutex mutex_; // one writer at a time
+    PersistentAdaptiveRadixTree<HttpEndpoint> match_routes_;
+    PersistentAdaptiveRadixTree<HttpEndpoint> regex_routes_;
+    std::unordered_map<std::string, std::shared_ptr<RouteStats>> stats_;
+    RouteStats not_found_{"", "*"};
+    std::atomic<int64_t> slow_ns_{0};
+    SlowHandler on_slow_;
+
+    // The request is moved into the handler, so what the slow log needs is kept aside
+    // only when a threshold is set.
+    template <typename Handler>
+    HttpResponse call(RouteStats &stats, HttpRequest req, const Handler &handler) {
+        using Clock = std::chrono::steady_clock;
+        auto slow_ns = slow_ns_.load(std::memory_order_relaxed);
+        size_t bytes_in = req.size;
+        HttpRequest head;
+        if (slow_ns > 0) {
+            head.url = req.url;
+            head.method = req.method;
+        }
+        auto start = Clock::now();
+        HttpResponse res = handler(std::move(req));
+        std::chrono::nanoseconds elapsed = Clock::now() - start;
+        bool slow = slow_ns > 0 && elapsed.count() > slow_ns;
+        stats.record(res.status, bytes_in, res.size(), elapsed, slow);
+        if (slow) {
+            on_slow_(head, res, elapsed);
+        }
+        return res;
+    }
 };
 
 } // namespace co_io
@@ -4,35 +4,78 @@
 #include "http/http_connection.hpp"
 #include "http/http_router.hpp"
 #include "io/async_file.hpp"
+#include "io/cpu.hpp"
+#include "io/inbox.hpp"
 #include "io/loop.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <thread>
 
 namespace co_io {
 
+// how new connections reach the workers
+enum class Dispatch {
+    ReusePort,    // every worker listens, the kernel hashes connections across them
+    ReusePortCpu, // as ReusePort, steered to worker cpu % workers by a CBPF program
+    Acceptor,     // one loop accepts and posts each fd to the least loaded worker
+};
+
 template <typename LoopType> class HttpWorker {
   public:
     HttpWorker(std::string_view ip, std::string_view port, HttpRouter &router,
                unsigned int time_out_sec)
-        : loop_(std::make_unique<LoopType>()), router_(router), time_out_sec_(time_out_sec) {
+        : HttpWorker(router, time_out_sec) {
         AddressSolver solver{ip, port};
         AddressSolver::AddressInfo info = solver.get_address_info();
         listener_ = AsyncFile::bind(info, loop_.get());
     }
 
+    // no listener, connections arrive through post()
+    HttpWorker(HttpRouter &router, unsigned int time_out_sec)
+        : loop_(std::make_unique<LoopType>()), router_(router), time_out_sec_(time_out_sec),
+          inbox_(loop_.get()) {}
+
     void start(bool new_thread) {
         if (new_thread) {
-            th_ = std::jthread([this] {
-                run_task(accept());
-                loop_->run();
-            });
+            th_ = std::jthread([this] { run(); });
         } else {
-            run_task(accept());
-            loop_->run();
+            run();
+        }
+    }
+
+    // Any thread. Hands an accepted nonblocking fd to this worker, false when its inbox is
+    // full and the caller still owns fd.
+    bool post(int fd) {
+        connections_.fetch_add(1, std::memory_order_relaxed);
+        if (!inbox_.post(fd)) {
+            connections_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // Runs the loop on cpu once started, with numa_local its later allocations (buffer
+    // segments, coroutine frames) come from the cpu's node. The listener prefers
+    // connections that arrive on the same cpu.
+    void pin(unsigned cpu, bool numa_local) {
+        cpu_ = static_cast<int>(cpu);
+        numa_local_ = numa_local;
+        if (listener_.fd() != -1) {
+            AsyncFile::incoming_cpu(listener_.fd(), cpu);
         }
     }
 
+    // open connections, including posted ones not picked up yet
+    size_t load() const { return connections_.load(std::memory_order_relaxed); }
+
+    int listen_fd() const { return listener_.fd(); }
+
+    // any thread
+    LoopMetrics::Snapshot metrics() const { return loop_->metrics()->snapshot(); }
+
     ~HttpWorker() {}
 
     HttpWorker(const HttpWorker &) = delete;
@@ -48,9 +91,29 @@ template <typename LoopType> class HttpWorker {
     AsyncFile listener_;
     HttpRouter &router_;
     unsigned int time_out_sec_ = 0;
+    Inbox<int> inbox_;
+    std::atomic<size_t> connections_{0};
+    int cpu_ = -1;
+    bool numa_local_ = false;
     std::jthread th_;
 
+    void run() {
+        if (cpu_ >= 0) {
+            pin_thread(static_cast<unsigned>(cpu_));
+            if (numa_local_) {
+                prefer_numa_node(numa_node(static_cast<unsigned>(cpu_)));
+            }
+        }
+        if (listener_.fd() != -1) {
+            run_task(accept());
+        } else {
+            run_task(receive());
+        }
+        loop_->run();
+    }
+
     Task<void> accept();
+    Task<void> receive();
     Task<void> client(int fd);
 };
 
@@ -62,14 +125,34 @@ template <typename LoopType> class HttpServer {
     HttpServer(std::string_view ip, std::string port);
 
     void start() {
-        for (unsigned i = 0; i + 1 < nthreads_; ++i) {
+        if (dispatch_ == Dispatch::Acceptor) {
+            for (unsigned i = 0; i < nthreads_; ++i) {
+                workers_.push_back(std::make_unique<WorkerType>(router_, time_out_sec_));
+                place(*workers_.back(), i);
+                workers_.back()->start(true);
+            }
+            route_metrics();
+            LoopType loop;
+            AddressSolver solver{ip_, port_};
+            AsyncFile listener = AsyncFile::bind(solver.get_address_info(), &loop);
+            run_task(dispatch(listener));
+            loop.run();
+            return;
+        }
+
+        // every listener has to join the reuseport group before the first one runs
+        for (unsigned i = 0; i < nthreads_; ++i) {
             workers_.push_back(std::make_unique<WorkerType>(ip_, port_, router_, time_out_sec_));
+            place(*workers_.back(), i);
+        }
+        route_metrics();
+        if (dispatch_ == Dispatch::ReusePortCpu) { // pinned workers get their own cpu's traffic
+            AsyncFile::reuseport_by_cpu(workers_.front()->listen_fd(), nthreads_, worker_cpus());
         }
-        for (auto &worker : workers_) {
-            worker->start(true);
+        for (size_t i = 0; i + 1 < workers_.size(); ++i) {
+            workers_[i]->start(true);
         }
-        WorkerTypePointer worker = std::make_unique<WorkerType>(ip_, port_, router_, time_out_sec_);
-        worker->start(false);
+        workers_.back()->start(false);
     }
 
     HttpRouter &route() { return router_; }
@@ -79,37 +162,137 @@ template <typename LoopType> class HttpServer {
         return *this;
     }
 
-    HttpServer &with_threads(unsigned int nthreads = std::thread::hardware_concurrency()) {
+    // defaults to one worker per cpu the process may run on
+    HttpServer &
+    with_threads(unsigned int nthreads = static_cast<unsigned>(available_cpus().size())) {
         this->nthreads_ = nthreads;
         return *this;
     }
 
+    HttpServer &with_dispatch(Dispatch dispatch) {
+        this->dispatch_ = dispatch;
+        return *this;
+    }
+
+    // Pins worker i to cpus[i % cpus.size()], numa_local keeps its memory on that node.
+    HttpServer &with_cpus(std::vector<unsigned> cpus, bool numa_local = true) {
+        this->cpus_ = std::move(cpus);
+        this->numa_local_ = numa_local;
+        return *this;
+    }
+
+    // Serves the counters of every worker loop and route at url in the Prometheus text
+    // format.
+    HttpServer &with_metrics(std::string url = "/metrics") {
+        this->metrics_url_ = std::move(url);
+        return *this;
+    }
+
+    // one snapshot per worker, in start order
+    std::vector<LoopMetrics::Snapshot> metrics() const {
+        std::vector<LoopMetrics::Snapshot> loops;
+        for (const auto &worker : workers_) {
+            loops.push_back(worker->metrics());
+        }
+        return loops;
+    }
+
   private:
     std::string ip_, port_;
     HttpRouter router_;
     unsigned int time_out_sec_ = 0;
     unsigned int nthreads_ = 1;
+    Dispatch dispatch_ = Dispatch::ReusePort;
+    std::vector<unsigned> cpus_;
+    bool numa_local_ = true;
+    std::string metrics_url_;
     std::vector<WorkerTypePointer> workers_;
+
+    // once workers_ is complete, it is not touched while the server runs
+    void route_metrics() {
+        if (metrics_url_.empty()) {
+            return;
+        }
+        router_.route(metrics_url_, HttpMethod::GET, [this](HttpRequest) -> HttpResponse {
+            HttpResponse res{200};
+            res.headers["Content-Type"] = "text/plain; version=0.0.4";
+            res.body = render_prometheus(metrics());
+            res.body += render_prometheus(router_.stats());
+            return res;
+        });
+    }
+
+    void place(WorkerType &worker, unsigned i) {
+        if (!cpus_.empty()) {
+            worker.pin(cpus_[i % cpus_.size()], numa_local_);
+        }
+    }
+
+    // cpu of every worker while each one has its own
+    std::vector<unsigned> worker_cpus() const {
+        if (cpus_.size() < nthreads_) {
+            return {};
+        }
+        return std::vector<unsigned>(cpus_.begin(), cpus_.begin() + nthreads_);
+    }
+
+    Task<void> dispatch(AsyncFile &listener);
 };
 
 template <typename LoopType>
 HttpServer<LoopType>::HttpServer(std::string_view ip, std::string port) : ip_(ip), port_(port) {}
 
 template <typename LoopType> Task<void> HttpWorker<LoopType>::accept() {
+    std::array<AsyncFile::Accepted, 64> accepted;
     while (true) {
-        AddressSolver::Address addr;
-        auto ret = co_await listener_.async_accept(addr);
+        auto ret = co_await listener_.async_accept(accepted);
         if (ret.is_error()) {
-        } else {
-            std::cerr << "accept ok " << ret.value() << std::endl;
-            run_task(client(ret.value()));
+            continue;
+        }
+        for (size_t i = 0; i < static_cast<size_t>(ret.value()); ++i) {
+            connections_.fetch_add(1, std::memory_order_relaxed);
+            run_task(client(accepted[i].fd));
+        }
+    }
+}
+
+template <typename LoopType> Task<void> HttpWorker<LoopType>::receive() {
+    while (true) {
+        auto ret = co_await inbox_.receive();
+        if (ret.is_error()) {
+            continue;
+        }
+        int fd;
+        while (inbox_.try_pop(fd)) {
+            run_task(client(fd));
         }
     }
 }
 
 template <typename LoopType> Task<void> HttpWorker<LoopType>::client(int fd) {
-    HttpConnection conn(AsyncFile{fd, loop_.get(), time_out_sec_}, router_);
-    co_await conn.handle();
+    {
+        HttpConnection conn(AsyncFile::adopt(fd, loop_.get(), time_out_sec_), router_);
+        co_await conn.handle();
+    }
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <typename LoopType> Task<void> HttpServer<LoopType>::dispatch(AsyncFile &listener) {
+    std::array<AsyncFile::Accepted, 64> accepted;
+    while (true) {
+        auto ret = co_await listener.async_accept(accepted);
+        if (ret.is_error()) {
+            continue;
+        }
+        for (size_t i = 0; i < static_cast<size_t>(ret.value()); ++i) {
+            auto &worker = *std::min_element(
+                workers_.begin(), workers_.end(),
+                [](const auto &a, const auto &b) { return a->load() < b->load(); });
+            if (!worker->post(accepted[i].fd)) { // even the idlest worker is backed up, shed it
+                ::close(accepted[i].fd);
+            }
+        }
+    }
 }
 
 } // namespace co_io
@@ -88,6 +88,21 @@ static inline int hex_to_val(char c) {
     return -1;
 }
 
+std::string UrlCodec::encode_url(std::string_view str) {
+    std::string encoded;
+    for (char c : str) {
+        if (std::string_view(URL_UNRESERVED).find(c) != std::string_view::npos) {
+            encoded.push_back(c);
+        } else {
+            auto byte = static_cast<unsigned char>(c);
+            encoded.push_back('%');
+            encoded.push_back(URL_PCT[byte >> 4]);
+            encoded.push_back(URL_PCT[byte & 0xf]);
+        }
+    }
+    return encoded;
+}
+
 std::string UrlCodec::decode_url(std::string_view str, bool plus_as_space) {
     if (str.size() < 3) {
         return std::string(str);
@@ -48,6 +48,7 @@ struct HttpRequest {
     enum HttpMethod method;
     std::string body;
     enum HttpVersion version;
+    size_t size = 0; // bytes on the wire, counting one space after each header colon
 
     bool keep_alive() const {
         auto it = headers.find("Connection");
@@ -80,6 +81,42 @@ struct HttpRequest {
         }
     }
 
+    // the client side: url is the request target as is, args are appended as its query
+    template <typename Buffer> void serialize(Buffer &buf) const {
+        buf.append(http_method(method));
+        buf.append(" ");
+        buf.append(url);
+        char separator = url.find('?') == std::string::npos ? '?' : '&';
+        for (auto &it : args) {
+            buf.append(std::string_view(&separator, 1));
+            buf.append(UrlCodec::encode_url(it.first));
+            buf.append("=");
+            buf.append(UrlCodec::encode_url(it.second));
+            separator = '&';
+        }
+        buf.append(" ");
+        buf.append(http_version(version));
+        buf.append("\r\n");
+
+        if (!body.empty() || method == HttpMethod::POST || method == HttpMethod::PUT ||
+            method == HttpMethod::PATCH) {
+            buf.append("Content-Length: ");
+            buf.append(std::to_string(body.size()));
+            buf.append("\r\n");
+        }
+        for (auto &it : headers) {
+            if (it.first == "Content-Length") {
+                continue;
+            }
+            buf.append(it.first);
+            buf.append(": ");
+            buf.append(it.second);
+            buf.append("\r\n");
+        }
+        buf.append("\r\n");
+        buf.append(body);
+    }
+
     void set_http_method(std::string_view m) { method = http_method(m); }
 
     void set_http_version(std::string_view v) { version = http_version(v); }
@@ -88,25 +125,41 @@ struct HttpRequest {
         headers.clear();
         url.clear();
         body.clear();
+        size = 0;
     }
 };
 
 struct HttpResponse {
-    void serialize(ByteBuffer &buf) const {
+    template <typename Buffer> void serialize(Buffer &buf) const {
         buf.append("HTTP/1.1 ");
         buf.append(std::to_string(status));
         buf.append(" ");
         buf.append(co_io::http_status(status));
         buf.append("\r\n");
 
-        buf.append("Content-Length: " + std::to_string(body.size()) + "\r\n");
+        buf.append("Content-Length: ");
+        buf.append(std::to_string(body.size()));
+        buf.append("\r\n");
         for (auto &it : headers) {
-            buf.append(it.first + ": " + it.second + "\r\n");
+            buf.append(it.first);
+            buf.append(": ");
+            buf.append(it.second);
+            buf.append("\r\n");
         }
         buf.append("\r\n");
         buf.append(body);
     }
 
+    // bytes serialize() appends
+    size_t size() const {
+        struct {
+            size_t bytes = 0;
+            void append(std::string_view data) { bytes += data.size(); }
+        } counter;
+        serialize(counter);
+        return counter.bytes;
+    }
+
     int status = 200;
     std::unordered_map<std::string, std::string> headers;
     std::string body;
@@ -0,0 +1,179 @@
+#include "http/route_stats.hpp"
+
+#include <cstdio>
+#include <string_view>
+
+namespace co_io {
+
+namespace {
+
+size_t thread_slot() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+void add(std::atomic<uint64_t> &counter, uint64_t n) noexcept {
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+} // namespace
+
+RouteStats::~RouteStats() {
+    for (auto &shard : shards_) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+RouteStats::Shard &RouteStats::shard() {
+    auto &slot = shards_[thread_slot() % Shards];
+    Shard *shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+        auto *fresh = new Shard;
+        if (slot.compare_exchange_strong(shard, fresh, std::memory_order_acq_rel)) {
+            shard = fresh;
+        } else {
+            delete fresh; // another thread of this slot was first
+        }
+    }
+    return *shard;
+}
+
+void RouteStats::record(int status, size_t bytes_in, size_t bytes_out,
+                        std::chrono::nanoseconds latency, bool slow) {
+    auto &s = shard();
+    add(s.requests, 1);
+    add(s.statuses[status >= 100 && status < 600 ? status / 100 : 0], 1);
+    add(s.bytes_in, bytes_in);
+    add(s.bytes_out, bytes_out);
+    add(s.slow, slow ? 1 : 0);
+    s.latency.record(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+}
+
+RouteStats::Snapshot RouteStats::snapshot() const {
+    Snapshot snapshot;
+    snapshot.url = url_;
+    snapshot.method = method_;
+    for (const auto &slot : shards_) {
+        const Shard *shard = slot.load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            continue;
+        }
+        auto get = [](const std::atomic<uint64_t> &c) { return c.load(std::memory_order_relaxed); };
+        snapshot.requests += get(shard->requests);
+        for (size_t i = 0; i < snapshot.statuses.size(); i++) {
+            snapshot.statuses[i] += get(shard->statuses[i]);
+        }
+        snapshot.bytes_in += get(shard->bytes_in);
+        snapshot.bytes_out += get(shard->bytes_out);
+        snapshot.slow += get(shard->slow);
+        shard->latency.merge_into(snapshot.latency);
+    }
+    return snapshot;
+}
+
+namespace {
+
+// label values escape backslash, quote and newline
+std::string escape(std::string_view value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out.push_back('\\');
+        } else if (c == '\n') {
+            out.append("\\n");
+            continue;
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+void header(std::string &out, std::string_view name, std::string_view type,
+            std::string_view help) {
+    out.append("# HELP co_io_route_").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE co_io_route_").append(name).append(" ").append(type).append("\n");
+}
+
+void metric(std::string &out, std::string_view name, const RouteStats::Snapshot &route,
+            std::string_view label, std::string_view label_value, uint64_t value) {
+    out.append("co_io_route_").append(name).append("{route=\"").append(escape(route.url));
+    out.append("\",method=\"").append(route.method);
+    if (!label.empty()) {
+        out.append("\",").append(label).append("=\"").append(label_value);
+    }
+    out.append("\"} ").append(std::to_string(value)).append("\n");
+}
+
+constexpr std::array<std::pair<uint64_t, std::string_view>, 12> LatencyBuckets = {{
+    {50'000, "0.00005"},
+    {100'000, "0.0001"},
+    {250'000, "0.00025"},
+    {500'000, "0.0005"},
+    {1'000'000, "0.001"},
+    {5'000'000, "0.005"},
+    {10'000'000, "0.01"},
+    {50'000'000, "0.05"},
+    {100'000'000, "0.1"},
+    {500'000'000, "0.5"},
+    {1'000'000'000, "1"},
+    {10'000'000'000, "10"},
+}};
+
+} // namespace
+
+std::string render_prometheus(std::span<const RouteStats::Snapshot> routes) {
+    std::string out;
+    header(out, "requests_total", "counter", "Requests by status class.");
+    for (const auto &route : routes) {
+        for (size_t i = 0; i < route.statuses.size(); i++) {
+            if (route.statuses[i] != 0) {
+                metric(out, "requests_total", route, "code", i ? std::to_string(i) + "xx" : "other",
+                       route.statuses[i]);
+            }
+        }
+    }
+    header(out, "received_bytes_total", "counter", "Request bytes.");
+    for (const auto &route : routes) {
+        metric(out, "received_bytes_total", route, {}, {}, route.bytes_in);
+    }
+    header(out, "sent_bytes_total", "counter", "Response bytes.");
+    for (const auto &route : routes) {
+        metric(out, "sent_bytes_total", route, {}, {}, route.bytes_out);
+    }
+    header(out, "slow_total", "counter", "Handlers that blocked their loop past the threshold.");
+    for (const auto &route : routes) {
+        metric(out, "slow_total", route, {}, {}, route.slow);
+    }
+
+    // a bucket of the histogram counts toward le once all of its values are at or below it
+    header(out, "handler_seconds", "histogram", "Time the handler ran.");
+    for (const auto &route : routes) {
+        std::array<uint64_t, LatencyBuckets.size()> counts{};
+        route.latency.for_each([&](uint64_t, uint64_t highest, uint64_t count) {
+            for (size_t i = 0; i < LatencyBuckets.size(); i++) {
+                if (highest <= LatencyBuckets[i].first) {
+                    counts[i] += count;
+                    break;
+                }
+            }
+        });
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < LatencyBuckets.size(); i++) {
+            cumulative += counts[i];
+            metric(out, "handler_seconds_bucket", route, "le", LatencyBuckets[i].second,
+                   cumulative);
+        }
+        metric(out, "handler_seconds_bucket", route, "le", "+Inf", route.latency.count());
+        auto sum = route.latency.mean() * static_cast<double>(route.latency.count()) / 1e9;
+        out.append("co_io_route_handler_seconds_sum{route=\"").append(escape(route.url));
+        out.append("\",method=\"").append(route.method).append("\"} ");
+        char value[32];
+        std::snprintf(value, sizeof(value), "%.9g", sum);
+        out.append(value).append("\n");
+        metric(out, "handler_seconds_count", route, {}, {}, route.latency.count());
+    }
+    return out;
+}
+
+} // namespace co_io
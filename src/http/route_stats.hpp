@@ -0,0 +1,66 @@
+#pragma once
+
+#include "http/http_util.hpp"
+#include "utils/histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <string>
+
+namespace co_io {
+
+// Request counters and handler latency of one route. Every thread records into a shard of
+// its own, created on its first request, so workers never share a cache line. Readers merge
+// the shards without stopping anyone.
+class RouteStats {
+  public:
+    static constexpr size_t Shards = 64; // threads past this share shards, slower but exact
+    static constexpr uint64_t MaxLatency = uint64_t{1} << 36; // ~69s in ns
+
+    struct Snapshot {
+        std::string url;    // as routed, the regex for regex routes
+        std::string method; // "*" for requests no route matched
+        uint64_t requests = 0;
+        std::array<uint64_t, 6> statuses{}; // by class, statuses[2] counts 2xx, [0] the rest
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        uint64_t slow = 0; // handlers over the router's slow threshold
+        Histogram latency{MaxLatency}; // handler time in ns
+    };
+
+    RouteStats(std::string url, std::string method)
+        : url_(std::move(url)), method_(std::move(method)) {}
+    ~RouteStats();
+
+    RouteStats(const RouteStats &) = delete;
+    RouteStats &operator=(const RouteStats &) = delete;
+
+    void record(int status, size_t bytes_in, size_t bytes_out, std::chrono::nanoseconds latency,
+                bool slow);
+
+    Snapshot snapshot() const;
+
+  private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> requests{0};
+        std::array<std::atomic<uint64_t>, 6> statuses{};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> slow{0};
+        AtomicHistogram latency{MaxLatency};
+    };
+
+    Shard &shard();
+
+    std::string url_;
+    std::string method_;
+    std::array<std::atomic<Shard *>, Shards> shards_{};
+};
+
+// Prometheus text exposition, labelled with route="<url>",method="<method>". Latency buckets
+// are fixed from 50us to 10s.
+std::string render_prometheus(std::span<const RouteStats::Snapshot> routes);
+
+} // namespace co_io
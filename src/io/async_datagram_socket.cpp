@@ -0,0 +1,143 @@
+#include "io/async_datagram_socket.hpp"
+#include "io/loop.hpp"
+#include "io/loop_metrics.hpp"
+#include "io/poller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <netinet/udp.h>
+
+namespace co_io {
+
+namespace {
+
+// room for the UDP_GRO int on receive and the UDP_SEGMENT uint16_t on send
+struct Control {
+    alignas(cmsghdr) char data[CMSG_SPACE(sizeof(int))];
+};
+
+} // namespace
+
+AsyncDatagramSocket AsyncDatagramSocket::bind(AddressSolver::Address const &addr,
+                                              LoopBase *loop) {
+    int type = SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC;
+    int fd = system_call(::socket(addr.addr_.sa_family, type, 0)).execption("socket");
+    AsyncDatagramSocket socket(fd, loop);
+    system_call(::bind(fd, &addr.addr_, addr.len_)).execption("bind");
+    return socket;
+}
+
+Execpted<int> AsyncDatagramSocket::connect(AddressSolver::Address const &addr) {
+    return system_call(::connect(fd(), &addr.addr_, addr.len_));
+}
+
+bool AsyncDatagramSocket::enable_gro() {
+    int on = 1;
+    return !system_call(::setsockopt(fd(), SOL_UDP, UDP_GRO, &on, sizeof(on))).is_error();
+}
+
+AddressSolver::Address AsyncDatagramSocket::local_address() const {
+    AddressSolver::Address addr{};
+    system_call(::getsockname(fd(), &addr.addr_, &addr.len_)).execption("getsockname");
+    return addr;
+}
+
+Task<Execpted<int>> AsyncDatagramSocket::recv_batch(std::span<Datagram> batch) {
+    auto count = std::min(batch.size(), MaxBatch);
+    std::array<mmsghdr, MaxBatch> msgs;
+    std::array<iovec, MaxBatch> iov;
+    std::array<Control, MaxBatch> control;
+    while (true) {
+        for (size_t i = 0; i < count; i++) {
+            auto &datagram = batch[i];
+            iov[i] = {datagram.buffer.data(), datagram.buffer.size()};
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_name = &datagram.peer.addr_storage_;
+            msgs[i].msg_hdr.msg_namelen = sizeof(datagram.peer.addr_storage_);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i].data;
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i].data);
+        }
+        auto result = system_call(
+            ::recvmmsg(fd(), msgs.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr));
+        if (result.is_error()) {
+            loop()->metrics()->read(0);
+            if (result.is_nonblocking_error()) {
+                co_await waiting_for_event(loop()->poller(), fd(), PollEvent::read());
+                continue;
+            }
+            co_return result;
+        }
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < static_cast<size_t>(result.value()); i++) {
+            auto &datagram = batch[i];
+            auto &hdr = msgs[i].msg_hdr;
+            datagram.length = msgs[i].msg_len;
+            datagram.peer.len_ = hdr.msg_namelen;
+            datagram.truncated = hdr.msg_flags & MSG_TRUNC;
+            datagram.segment_size = 0;
+            for (auto *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int size = 0;
+                    std::memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                    datagram.segment_size = static_cast<uint16_t>(size);
+                }
+            }
+            bytes += msgs[i].msg_len;
+        }
+        loop()->metrics()->read(bytes);
+        co_return result;
+    }
+}
+
+Task<Execpted<int>> AsyncDatagramSocket::send_batch(std::span<const Datagram> batch) {
+    std::array<mmsghdr, MaxBatch> msgs;
+    std::array<iovec, MaxBatch> iov;
+    std::array<Control, MaxBatch> control;
+    size_t sent = 0;
+    while (sent < batch.size()) {
+        auto count = std::min(batch.size() - sent, MaxBatch);
+        for (size_t i = 0; i < count; i++) {
+            const auto &datagram = batch[sent + i];
+            iov[i] = {datagram.buffer.data(), datagram.buffer.size()};
+            msgs[i] = {};
+            auto &hdr = msgs[i].msg_hdr;
+            if (datagram.peer.addr_.sa_family != AF_UNSPEC) {
+                hdr.msg_name = const_cast<sockaddr_storage *>(&datagram.peer.addr_storage_);
+                hdr.msg_namelen = datagram.peer.len_;
+            }
+            hdr.msg_iov = &iov[i];
+            hdr.msg_iovlen = 1;
+            if (datagram.segment_size > 0) {
+                hdr.msg_control = control[i].data;
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                auto *cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                std::memcpy(CMSG_DATA(cmsg), &datagram.segment_size, sizeof(uint16_t));
+            }
+        }
+        auto result = system_call(
+            ::sendmmsg(fd(), msgs.data(), static_cast<unsigned>(count), MSG_DONTWAIT));
+        if (result.is_error()) {
+            loop()->metrics()->wrote(0);
+            if (result.is_nonblocking_error()) {
+                co_await waiting_for_event(loop()->poller(), fd(), PollEvent::write());
+                continue;
+            }
+            co_return sent > 0 ? Execpted<int>(static_cast<int>(sent)) : result;
+        }
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < static_cast<size_t>(result.value()); i++) {
+            bytes += batch[sent + i].buffer.size();
+        }
+        loop()->metrics()->wrote(bytes);
+        sent += static_cast<size_t>(result.value());
+    }
+    co_return Execpted<int>(static_cast<int>(sent));
+}
+
+} // namespace co_io
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+#include "utils/system_call.hpp"
+
+namespace co_io {
+
+// one datagram of a batch
+struct Datagram {
+    std::span<char> buffer;        // received into, or sent whole
+    size_t length = 0;             // bytes received
+    AddressSolver::Address peer{}; // received from, or sent to, AF_UNSPEC to the connected one
+    // GRO: the received buffer holds datagrams of this size, the last may be shorter.
+    // GSO: the kernel sends buffer as datagrams of this size. 0 is one datagram.
+    uint16_t segment_size = 0;
+    bool truncated = false; // longer than buffer, the rest was dropped
+};
+
+// A UDP socket that moves up to MaxBatch datagrams per recvmmsg or sendmmsg call. Both try
+// the call first and only wait for the loop when the socket has nothing to read or no room,
+// a socket under load never waits.
+class AsyncDatagramSocket {
+  public:
+    static constexpr size_t MaxBatch = 64;
+
+    // a nonblocking socket of addr's family bound to addr, port 0 picks one
+    static AsyncDatagramSocket bind(AddressSolver::Address const &addr, LoopBase *loop);
+    // fd is a nonblocking datagram socket
+    AsyncDatagramSocket(int fd, LoopBase *loop) : file_(AsyncFile::adopt(fd, loop)) {}
+
+    // Waits for at least one datagram and returns how many of batch were filled. A
+    // datagram with segment_size set from GRO stands for several.
+    Task<Execpted<int>> recv_batch(std::span<Datagram> batch);
+    // Returns how many of batch were sent, all of them unless one failed: that error comes
+    // back when the rest is sent again.
+    Task<Execpted<int>> send_batch(std::span<const Datagram> batch);
+
+    // fixes the peer of datagrams sent to AF_UNSPEC and drops datagrams from others
+    Execpted<int> connect(AddressSolver::Address const &addr);
+    // Lets the kernel coalesce received datagrams of one flow, see Datagram::segment_size.
+    // false when the kernel does not support it.
+    bool enable_gro();
+    AddressSolver::Address local_address() const;
+
+    int fd() const { return file_.fd(); }
+    LoopBase *loop() const noexcept { return file_.loop(); }
+
+  private:
+    AsyncFile file_;
+};
+
+} // namespace co_io
@@ -3,28 +3,51 @@
 #include "io/loop.hpp"
 #include "io/poller.hpp"
 
+#include <algorithm>
+#include <linux/filter.h>
+#include <vector>
+
 namespace co_io {
 
 AsyncFile::AsyncFile(int fd, LoopBase *loop, unsigned time_out_sec)
+    : AsyncFile(set_nonblocking(fd), loop, time_out_sec, Nonblocking{}) {}
+
+AsyncFile::AsyncFile(int fd, LoopBase *loop, unsigned time_out_sec, Nonblocking)
     : FileDescriptor(fd), loop_(loop), time_out_sec_(time_out_sec) {
+    loop_->poller()->register_fd(fd);
+    metrics().fd_registered();
+}
+
+AsyncFile AsyncFile::adopt(int fd, LoopBase *loop, unsigned time_out_sec) {
+    return AsyncFile(fd, loop, time_out_sec, Nonblocking{});
+}
+
+LoopMetrics &AsyncFile::metrics() const { return *loop_->metrics(); }
+
+int AsyncFile::set_nonblocking(int fd) {
     auto flags = system_call(fcntl(fd, F_GETFL)).execption("fcntl");
     system_call(fcntl(fd, F_SETFL, flags | O_NONBLOCK)).execption("fcntl");
-    loop_->poller()->register_fd(fd);
+    return fd;
+}
+
+Task<bool> AsyncFile::wait_readable() {
+    if (time_out_sec_ > 0) {
+        auto ret =
+            co_await when_any(waiting_for_event(loop_->poller(), fd(), PollEvent::read()),
+                              loop_->timer()->sleep_for(std::chrono::seconds(time_out_sec_)));
+        co_return ret.index == 0;
+    }
+    co_await waiting_for_event(loop_->poller(), fd(), PollEvent::read());
+    co_return true;
 }
 
 Task<Execpted<ssize_t>> AsyncFile::async_read(void *buf, size_t size) {
     while (true) {
-        if (time_out_sec_ > 0) {
-            auto ret =
-                co_await when_any(waiting_for_event(loop_->poller(), fd(), PollEvent::read()),
-                                  loop_->timer()->sleep_for(std::chrono::seconds(time_out_sec_)));
-            if (ret.index == 1) { // timeout
-                co_return Execpted<ssize_t>(std::error_code(ETIMEDOUT, std::system_category()));
-            }
-        } else {
-            co_await waiting_for_event(loop_->poller(), fd(), PollEvent::read());
+        if (!co_await wait_readable()) {
+            co_return Execpted<ssize_t>(std::error_code(ETIMEDOUT, std::system_category()));
         }
         auto result = system_call(::read(fd(), buf, size));
+        metrics().read(result.is_error() ? 0 : static_cast<uint64_t>(result.value()));
         if (result.is_nonblocking_error()) {
             continue;
         }
@@ -36,10 +59,34 @@ Task<Execpted<ssize_t>> AsyncFile::async_read(ByteBuffer &buf) {
     return async_read(buf.data(), buf.size());
 }
 
+Task<Execpted<ssize_t>> AsyncFile::async_read(ChainBuffer &buf, size_t size_hint) {
+    while (true) {
+        if (!co_await wait_readable()) {
+            co_return Execpted<ssize_t>(std::error_code(ETIMEDOUT, std::system_category()));
+        }
+        // segments are only leased once data is there, idle connections hold none
+        iovec iov[4];
+        auto count = buf.prepare(size_hint, iov);
+        auto result = system_call(::readv(fd(), iov, static_cast<int>(count)));
+        metrics().read(result.is_error() ? 0 : static_cast<uint64_t>(result.value()));
+        if (!result.is_error()) {
+            buf.commit(static_cast<size_t>(result.value()));
+        }
+        if (buf.empty()) {
+            buf.clear();
+        }
+        if (result.is_nonblocking_error()) {
+            continue;
+        }
+        co_return result;
+    }
+}
+
 Task<Execpted<ssize_t>> AsyncFile::async_write(const void *buf, size_t size) {
     while (true) {
         co_await waiting_for_event(loop_->poller(), fd(), PollEvent::write());
         auto result = system_call(::write(fd(), buf, size));
+        metrics().wrote(result.is_error() ? 0 : static_cast<uint64_t>(result.value()));
         if (result.is_nonblocking_error()) {
             continue;
         }
@@ -51,10 +98,33 @@ Task<Execpted<ssize_t>> AsyncFile::async_write(std::string_view buf) {
     return async_write(buf.data(), buf.size());
 }
 
-Task<Execpted<int>> AsyncFile::async_accept(AddressSolver::Address &) {
+Task<Execpted<ssize_t>> AsyncFile::async_writev(ChainBuffer &buf) {
+    ssize_t total = 0;
+    while (!buf.empty()) {
+        co_await waiting_for_event(loop_->poller(), fd(), PollEvent::write());
+        iovec iov[16];
+        auto count = buf.readable(iov);
+        auto result = system_call(::writev(fd(), iov, static_cast<int>(count)));
+        metrics().wrote(result.is_error() ? 0 : static_cast<uint64_t>(result.value()));
+        if (result.is_nonblocking_error()) {
+            continue;
+        }
+        if (result.is_error()) {
+            co_return result;
+        }
+        buf.consume(static_cast<size_t>(result.value()));
+        total += result.value();
+    }
+    co_return Execpted<ssize_t>(total);
+}
+
+Task<Execpted<int>> AsyncFile::async_accept(AddressSolver::Address &peer) {
     while (true) {
         co_await waiting_for_event(loop_->poller(), fd(), PollEvent::read());
-        auto result = system_call(::accept(fd(), nullptr, nullptr));
+        peer.len_ = sizeof(peer.addr_storage_);
+        auto result = system_call(
+            ::accept4(fd(), &peer.addr_, &peer.len_, SOCK_NONBLOCK | SOCK_CLOEXEC));
+        metrics().accepted(result.is_error() ? 0 : 1);
         if (result.is_nonblocking_error()) {
             continue;
         }
@@ -62,14 +132,159 @@ Task<Execpted<int>> AsyncFile::async_accept(AddressSolver::Address &) {
     }
 }
 
-Task<Execpted<int>> AsyncFile::async_connect(AddressSolver::Address const &addr) {
+Task<Execpted<int>> AsyncFile::async_accept(std::span<Accepted> out) {
     while (true) {
+        co_await waiting_for_event(loop_->poller(), fd(), PollEvent::read());
+        // edge triggered, so keep accepting until the backlog is empty or out is full
+        int count = 0;
+        while (static_cast<size_t>(count) < out.size()) {
+            auto &peer = out[static_cast<size_t>(count)].peer;
+            peer.len_ = sizeof(peer.addr_storage_);
+            auto result = system_call(
+                ::accept4(fd(), &peer.addr_, &peer.len_, SOCK_NONBLOCK | SOCK_CLOEXEC));
+            metrics().accepted(result.is_error() ? 0 : 1);
+            if (result.is_errno(ECONNABORTED) || result.is_errno(EINTR)) {
+                continue;
+            }
+            if (result.is_error()) {
+                // the error comes back on the next call once these are handed out
+                if (count == 0 && !result.is_nonblocking_error()) {
+                    co_return result;
+                }
+                break;
+            }
+            out[static_cast<size_t>(count++)].fd = result.value();
+        }
+        if (count > 0) {
+            co_return Execpted<int>(count);
+        }
+    }
+}
+
+Execpted<int> AsyncFile::connect_result(int fd) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    auto result = system_call(::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len));
+    if (result.is_error() || error == 0) {
+        return result;
+    }
+    return Execpted<int>(std::error_code(error, std::system_category()));
+}
+
+Task<Execpted<int>> AsyncFile::async_connect(AddressSolver::Address const &addr,
+                                             std::chrono::milliseconds timeout) {
+    // a nonblocking connect that was interrupted also goes on in the background
+    auto result = system_call(::connect(fd(), &addr.addr_, addr.len_));
+    if (!result.is_errno(EINPROGRESS) && !result.is_errno(EINTR)) {
+        co_return result;
+    }
+    if (timeout.count() > 0) {
+        auto ret = co_await when_any(waiting_for_event(loop_->poller(), fd(), PollEvent::write()),
+                                     loop_->timer()->sleep_for(timeout));
+        if (ret.index != 0) {
+            co_return Execpted<int>(std::error_code(ETIMEDOUT, std::system_category()));
+        }
+    } else {
         co_await waiting_for_event(loop_->poller(), fd(), PollEvent::write());
-        auto result = system_call(::connect(fd(), &addr.addr_, addr.len_));
-        if (result.is_nonblocking_error()) {
+    }
+    co_return connect_result(fd());
+}
+
+namespace {
+
+constexpr size_t Timer = size_t(-1);
+
+Task<size_t> writable(LoopBase *loop, int fd, size_t index) {
+    co_await waiting_for_event(loop->poller(), fd, PollEvent::write());
+    co_return index;
+}
+
+Task<size_t> wake_at(LoopBase *loop, std::chrono::steady_clock::time_point when) {
+    co_await loop->timer()->sleep_until(when);
+    co_return Timer;
+}
+
+// RFC 8305 section 4, keeps the order within each family
+std::vector<AddressSolver::Address>
+interleave_families(std::span<const AddressSolver::Address> addrs) {
+    std::vector<AddressSolver::Address> first, other, out;
+    for (const auto &addr : addrs) {
+        auto &family = addr.addr_.sa_family == addrs.front().addr_.sa_family ? first : other;
+        family.push_back(addr);
+    }
+    for (size_t i = 0; i < std::max(first.size(), other.size()); i++) {
+        if (i < first.size()) {
+            out.push_back(first[i]);
+        }
+        if (i < other.size()) {
+            out.push_back(other[i]);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+// The kernel keeps connecting while no coroutine waits, so each round waits on the
+// attempts in flight and the next start, and the losers of when_any only lose their wait.
+Task<Execpted<int>> AsyncFile::async_connect_any(std::span<const AddressSolver::Address> addrs,
+                                                 LoopBase *loop,
+                                                 std::chrono::milliseconds timeout,
+                                                 std::chrono::milliseconds attempt_delay) {
+    using Clock = std::chrono::steady_clock;
+    auto order = interleave_families(addrs);
+    auto deadline = timeout.count() > 0 ? Clock::now() + timeout : Clock::time_point::max();
+    Execpted<int> error(std::error_code(EHOSTUNREACH, std::system_category()));
+    std::vector<AsyncFile> attempts; // in progress
+    size_t next = 0;
+    auto next_start = Clock::now();
+    while (true) {
+        while (next < order.size() && Clock::now() >= next_start) {
+            const auto &addr = order[next++];
+            auto fd = system_call(
+                ::socket(addr.addr_.sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+            if (fd.is_error()) {
+                error = fd;
+                continue;
+            }
+            AsyncFile file = adopt(fd.value(), loop);
+            auto result = system_call(::connect(file.fd(), &addr.addr_, addr.len_));
+            if (!result.is_error()) {
+                co_return Execpted<int>(file.release());
+            }
+            if (!result.is_errno(EINPROGRESS) && !result.is_errno(EINTR)) {
+                error = result; // the next one starts right away
+                continue;
+            }
+            attempts.push_back(std::move(file));
+            next_start = Clock::now() + attempt_delay;
+        }
+        if (attempts.empty() && next == order.size()) {
+            co_return error;
+        }
+        if (Clock::now() >= deadline) {
+            co_return Execpted<int>(std::error_code(ETIMEDOUT, std::system_category()));
+        }
+
+        std::vector<Task<size_t>> events;
+        for (size_t i = 0; i < attempts.size(); i++) {
+            events.push_back(writable(loop, attempts[i].fd(), i));
+        }
+        auto wake = next < order.size() ? std::min(next_start, deadline) : deadline;
+        if (wake != Clock::time_point::max()) {
+            events.push_back(wake_at(loop, wake));
+        }
+        size_t ready = (co_await when_any(events)).value;
+        if (ready == Timer) {
             continue;
         }
-        co_return result;
+        auto result = connect_result(attempts[ready].fd());
+        if (!result.is_error()) {
+            co_return Execpted<int>(attempts[ready].release());
+        }
+        error = result;
+        attempts.erase(attempts.begin() + static_cast<std::ptrdiff_t>(ready));
+        next_start = Clock::now();
     }
 }
 
@@ -90,10 +305,41 @@ int AsyncFile::create_listen(AddressSolver::AddressInfo const &addr) {
     return fd;
 }
 
+void AsyncFile::reuseport_by_cpu(int listen_fd, unsigned sockets,
+                                 std::span<const unsigned> cpus) {
+    std::vector<sock_filter> code;
+    code.push_back(
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)});
+    for (unsigned i = 0; i < cpus.size() && i < sockets; i++) {
+        code.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 1, cpus[i]}); // else skip the return
+        code.push_back({BPF_RET | BPF_K, 0, 0, i});
+    }
+    code.push_back({BPF_ALU | BPF_MOD | BPF_K, 0, 0, sockets});
+    code.push_back({BPF_RET | BPF_A, 0, 0, 0});
+    sock_fprog prog{.len = static_cast<unsigned short>(code.size()), .filter = code.data()};
+    system_call(setsockopt(listen_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)))
+        .execption("setsockopt SO_ATTACH_REUSEPORT_CBPF");
+}
+
+void AsyncFile::incoming_cpu(int listen_fd, unsigned cpu) {
+    int value = static_cast<int>(cpu);
+    system_call(setsockopt(listen_fd, SOL_SOCKET, SO_INCOMING_CPU, &value, sizeof(value)))
+        .execption("setsockopt SO_INCOMING_CPU");
+}
+
+int AsyncFile::release() {
+    if (fd() != -1) {
+        loop_->poller()->unregister_fd(fd());
+        metrics().fd_unregistered();
+    }
+    return FileDescriptor::release();
+}
+
 AsyncFile::~AsyncFile() {
     if (fd() != -1) {
         // std::cerr << "~AsyncFile() " << fd() << std::endl;
         loop_->poller()->unregister_fd(fd());
+        metrics().fd_unregistered();
     }
 }
 
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <chrono>
 #include <cstring>
 #include <fcntl.h>
 #include <netdb.h>
+#include <span>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <utility>
+#include <vector>
 
 #include "coroutine/task.hpp"
 #include "utils/byte_buffer.hpp"
+#include "utils/chain_buffer.hpp"
 #include "utils/system_call.hpp"
 
 namespace co_io {
@@ -19,6 +23,8 @@ class FileDescriptor {
     FileDescriptor() = default;
 
     int fd() const { return fd_; }
+    // the caller owns the fd
+    int release() noexcept { return std::exchange(fd_, -1); }
 
     FileDescriptor(FileDescriptor &&other) : fd_(other.fd_) { other.fd_ = -1; }
 
@@ -37,6 +43,7 @@ class FileDescriptor {
     int fd_ = -1;
 };
 
+// Calls the blocking getaddrinfo, for setting up listeners. Coroutines use Resolver.
 struct AddressSolver {
     struct Address {
         union {
@@ -82,8 +89,21 @@ struct AddressSolver {
 
     AddressInfo get_address_info() { return {addrinfo_}; }
 
+    // every address of socktype, in the order getaddrinfo sorted them
+    std::vector<Address> addresses(int socktype = SOCK_STREAM) const {
+        std::vector<Address> out;
+        for (AddressInfo info{addrinfo_}; info.ptr != nullptr; info.ptr = info.ptr->ai_next) {
+            if (info.ptr->ai_socktype == socktype) {
+                out.push_back(info.get_address());
+            }
+        }
+        return out;
+    }
+
     AddressSolver() = default;
-    AddressSolver(AddressSolver &&other) : addrinfo_(other.addrinfo_) { addrinfo_ = nullptr; }
+    AddressSolver(AddressSolver &&other) : addrinfo_(other.addrinfo_) {
+        other.addrinfo_ = nullptr;
+    }
 
     ~AddressSolver() {
         if (addrinfo_) {
@@ -93,30 +113,84 @@ struct AddressSolver {
 };
 
 class LoopBase;
+class LoopMetrics;
 
 class AsyncFile : public FileDescriptor {
   public:
+    struct Accepted {
+        int fd = -1;
+        AddressSolver::Address peer;
+    };
+
     explicit AsyncFile(int fd, LoopBase *loop, unsigned time_out_sec = 0);
+    // fd is already O_NONBLOCK, e.g. from accept4 or socket(SOCK_NONBLOCK)
+    static AsyncFile adopt(int fd, LoopBase *loop, unsigned time_out_sec = 0);
 
     Task<Execpted<ssize_t>> async_read(void *buf, size_t size);
     Task<Execpted<ssize_t>> async_read(ByteBuffer &buf);
+    // Appends up to size_hint bytes, more when the last segment has room left. Segments are
+    // taken from the pool once the fd is readable and an empty buffer gives them back.
+    Task<Execpted<ssize_t>> async_read(ChainBuffer &buf, size_t size_hint = BufferSegment::Size);
     Task<Execpted<ssize_t>> async_write(const void *buf, size_t size);
     Task<Execpted<ssize_t>> async_write(std::string_view buf);
-    Task<Execpted<int>> async_accept(AddressSolver::Address &);
-    Task<Execpted<int>> async_connect(AddressSolver::Address const &addr);
+    // writes and consumes all readable bytes of buf
+    Task<Execpted<ssize_t>> async_writev(ChainBuffer &buf);
+    // accepted sockets are nonblocking and close-on-exec
+    Task<Execpted<int>> async_accept(AddressSolver::Address &peer);
+    // Drains up to out.size() pending connections per wakeup, returns how many were stored.
+    Task<Execpted<int>> async_accept(std::span<Accepted> out);
+    // Fails with ETIMEDOUT when the connection is not established within timeout, zero
+    // waits as long as the kernel keeps trying.
+    Task<Execpted<int>> async_connect(AddressSolver::Address const &addr,
+                                      std::chrono::milliseconds timeout = {});
+    // Races connections to addrs as RFC 8305 (happy eyeballs) describes: address families
+    // alternate, starting with the one getaddrinfo sorted first, and a new attempt starts
+    // attempt_delay after the previous one or as soon as it failed. The first connection
+    // wins and the others are closed, on failure the last error is returned. The fd is
+    // nonblocking and close-on-exec, for adopt().
+    static Task<Execpted<int>>
+    async_connect_any(std::span<const AddressSolver::Address> addrs, LoopBase *loop,
+                      std::chrono::milliseconds timeout = {},
+                      std::chrono::milliseconds attempt_delay = std::chrono::milliseconds(250));
     static AsyncFile bind(AddressSolver::AddressInfo const &addr, LoopBase *loop);
     static int create_listen(AddressSolver::AddressInfo const &addr);
+    // Steers new connections of a SO_REUSEPORT group by the cpu that received them: to
+    // socket i when cpu == cpus[i], else to socket cpu % sockets. Sockets are numbered in
+    // bind order and attaching to one listener applies to the whole group.
+    static void reuseport_by_cpu(int listen_fd, unsigned sockets,
+                                 std::span<const unsigned> cpus = {});
+    // prefer this listener for connections whose packets arrive on cpu
+    static void incoming_cpu(int listen_fd, unsigned cpu);
 
     AsyncFile() = default;
     AsyncFile(AsyncFile &&other) = default;
-    AsyncFile &operator=(AsyncFile &&other) = default;
+    // swaps, so the fd left in other is unregistered from its own loop
+    AsyncFile &operator=(AsyncFile &&other) {
+        FileDescriptor::operator=(std::move(other));
+        std::swap(loop_, other.loop_);
+        std::swap(time_out_sec_, other.time_out_sec_);
+        return *this;
+    }
 
     AsyncFile(AsyncFile const &) = delete;
     AsyncFile &operator=(AsyncFile const &) = delete;
 
     ~AsyncFile();
 
+    LoopBase *loop() const noexcept { return loop_; }
+    // unregisters the fd from its loop, the caller owns it
+    int release();
+
   private:
+    struct Nonblocking {};
+    AsyncFile(int fd, LoopBase *loop, unsigned time_out_sec, Nonblocking);
+    static int set_nonblocking(int fd);
+    // the outcome of a connect that was in progress once the fd turned writable
+    static Execpted<int> connect_result(int fd);
+    LoopMetrics &metrics() const;
+
+    Task<bool> wait_readable(); // false on timeout
+
     LoopBase *loop_ = nullptr;
     unsigned time_out_sec_ = 0;
 };
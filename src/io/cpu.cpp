@@ -0,0 +1,57 @@
+#include "io/cpu.hpp"
+#include "utils/system_call.hpp"
+
+#include <filesystem>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace co_io {
+
+std::vector<unsigned> available_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    system_call(sched_getaffinity(0, sizeof(set), &set)).execption("sched_getaffinity");
+    std::vector<unsigned> cpus;
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void pin_thread(unsigned cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    system_call(sched_setaffinity(0, sizeof(set), &set)).execption("sched_setaffinity");
+}
+
+int numa_node(unsigned cpu) {
+    // the cpu directory links to its node as nodeN
+    std::error_code err;
+    auto dir = std::filesystem::path("/sys/devices/system/cpu") / ("cpu" + std::to_string(cpu));
+    for (const auto &entry : std::filesystem::directory_iterator(dir, err)) {
+        auto name = entry.path().filename().string();
+        if (name.starts_with("node") && name.size() > 4 &&
+            name.find_first_not_of("0123456789", 4) == std::string::npos) {
+            return std::stoi(name.substr(4));
+        }
+    }
+    return -1;
+}
+
+bool prefer_numa_node(int node) {
+    constexpr int Bits = 8 * sizeof(unsigned long);
+    if (node < 0 || node >= Bits) {
+        return false;
+    }
+    unsigned long mask = 1ul << node;
+    // no libnuma dependency for a single call
+    return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, Bits + 1) == 0;
+}
+
+} // namespace co_io
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+namespace co_io {
+
+// cpus the process may run on, in ascending order
+std::vector<unsigned> available_cpus();
+
+// binds the calling thread to cpu
+void pin_thread(unsigned cpu);
+
+// NUMA node of cpu, -1 when the kernel does not say
+int numa_node(unsigned cpu);
+
+// Makes later allocations of the calling thread prefer memory on node. Best effort, false
+// when the kernel refuses (no NUMA support, seccomp).
+bool prefer_numa_node(int node);
+
+} // namespace co_io
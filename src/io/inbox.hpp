@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <sys/eventfd.h>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+#include "utils/mpsc_queue.hpp"
+
+namespace co_io {
+
+// Hands values from any thread to the loop that owns the inbox. post() queues without
+// locks and only writes the eventfd when the loop may be asleep, the loop side waits in
+// receive() and then drains with try_pop().
+template <typename T> class Inbox {
+  public:
+    explicit Inbox(LoopBase *loop, size_t capacity = 4096)
+        : queue_(capacity),
+          event_(AsyncFile::adopt(
+              system_call(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)).execption("eventfd"),
+              loop)) {}
+
+    // any thread, false when the inbox is full
+    template <typename U> bool post(U &&value) {
+        if (!queue_.try_push(std::forward<U>(value))) {
+            return false;
+        }
+        // pairs with the fence in receive(): either the loop sees the value or we see that
+        // it cleared the flag and wake it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!signalled_.exchange(true, std::memory_order_acq_rel)) {
+            uint64_t one = 1;
+            system_call(::write(event_.fd(), &one, sizeof(one))).execption("eventfd write");
+        }
+        return true;
+    }
+
+    // loop side, resumes once values may be waiting
+    Task<Execpted<ssize_t>> receive() {
+        uint64_t count = 0;
+        auto ret = co_await event_.async_read(&count, sizeof(count));
+        signalled_.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        co_return ret;
+    }
+
+    // loop side
+    bool try_pop(T &value) { return queue_.try_pop(value); }
+
+  private:
+    MpscQueue<T> queue_;
+    AsyncFile event_;
+    std::atomic<bool> signalled_{false};
+};
+
+} // namespace co_io
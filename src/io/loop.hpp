@@ -1,7 +1,11 @@
 #pragma once
 
+#include "io/loop_metrics.hpp"
 #include "io/poller.hpp"
 #include "io/timer_context.hpp"
+#include "utils/chain_buffer.hpp"
+
+#include <memory>
 
 namespace co_io {
 
@@ -12,6 +16,10 @@ class LoopBase {
     virtual void stop() = 0;
     virtual PollerBase *poller() const = 0;
     virtual TimerContext *timer() const = 0;
+    // segments of the read and write buffers of every connection on this loop
+    virtual SegmentPool *buffers() const = 0;
+    // counters of this loop, written by its thread only
+    virtual LoopMetrics *metrics() const = 0;
 };
 
 template <typename POLLER> class Loop : public LoopBase {
@@ -20,6 +28,8 @@ template <typename POLLER> class Loop : public LoopBase {
 
     PollerBase *poller() const override { return poller_.get(); }
     TimerContext *timer() const override { return timer_.get(); }
+    SegmentPool *buffers() const override { return buffers_.get(); }
+    LoopMetrics *metrics() const override { return metrics_.get(); }
 
     void run() override {
         size_t i = 0;
@@ -35,16 +45,22 @@ template <typename POLLER> class Loop : public LoopBase {
     }
 
   private:
+    // first, the timer's fd is registered while the rest is constructed
+    std::unique_ptr<LoopMetrics> metrics_;
     PollerBasePtr poller_;
     TimerContextPtr timer_;
+    std::unique_ptr<SegmentPool> buffers_;
     bool stop_{false};
     size_t count_{0};
 };
 
 template <typename POLLER>
 Loop<POLLER>::Loop(size_t count)
-    : poller_(std::make_unique<POLLER>()),
-      timer_(std::make_unique<TimerContext>(this)), count_{count} {}
+    : metrics_(std::make_unique<LoopMetrics>()), poller_(std::make_unique<POLLER>()),
+      timer_(std::make_unique<TimerContext>(this)),
+      buffers_(std::make_unique<SegmentPool>()), count_{count} {
+    poller_->set_metrics(metrics_.get());
+}
 
 // template <typename POLLER>
 // Loop<POLLER>::Loop(size_t count)
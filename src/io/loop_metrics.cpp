@@ -0,0 +1,109 @@
+#include "io/loop_metrics.hpp"
+
+#include <string_view>
+
+namespace co_io {
+
+LoopMetrics::Snapshot LoopMetrics::snapshot() const noexcept {
+    auto get = [](const Counter &counter) { return counter.load(std::memory_order_relaxed); };
+    Snapshot s;
+    s.polls = get(polls_);
+    s.events = get(events_);
+    s.blocked_ns = get(blocked_ns_);
+    s.busy_ns = get(busy_ns_);
+    s.resumes = get(resumes_);
+    s.timers_fired = get(timers_fired_);
+    s.timers_cancelled = get(timers_cancelled_);
+    s.fds = get(fds_);
+    s.accepts = get(accepts_);
+    s.connections = get(connections_);
+    s.reads = get(reads_);
+    s.read_bytes = get(read_bytes_);
+    s.writes = get(writes_);
+    s.write_bytes = get(write_bytes_);
+    for (size_t i = 0; i < Buckets; i++) {
+        s.events_per_poll[i] = get(events_per_poll_[i]);
+        s.busy_us[i] = get(busy_us_[i]);
+    }
+    return s;
+}
+
+namespace {
+
+void header(std::string &out, std::string_view name, std::string_view type,
+            std::string_view help) {
+    out.append("# HELP co_io_loop_").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE co_io_loop_").append(name).append(" ").append(type).append("\n");
+}
+
+void metric(std::string &out, std::string_view name, size_t loop, std::string_view le,
+            std::string_view value) {
+    out.append("co_io_loop_").append(name).append("{loop=\"").append(std::to_string(loop));
+    if (!le.empty()) {
+        out.append("\",le=\"").append(le);
+    }
+    out.append("\"} ").append(value).append("\n");
+}
+
+void scalar(std::string &out, std::span<const LoopMetrics::Snapshot> loops, std::string_view name,
+            std::string_view type, std::string_view help,
+            uint64_t LoopMetrics::Snapshot::*field) {
+    header(out, name, type, help);
+    for (size_t i = 0; i < loops.size(); i++) {
+        metric(out, name, i, {}, std::to_string(loops[i].*field));
+    }
+}
+
+// buckets are cumulative in the exposition format, le is the highest value of each
+template <typename Sum>
+void histogram(std::string &out, std::span<const LoopMetrics::Snapshot> loops,
+               std::string_view name, std::string_view help,
+               std::array<uint64_t, LoopMetrics::Buckets> LoopMetrics::Snapshot::*buckets,
+               Sum sum) {
+    header(out, name, "histogram", help);
+    std::string bucket = std::string(name) + "_bucket";
+    for (size_t i = 0; i < loops.size(); i++) {
+        uint64_t count = 0;
+        for (size_t b = 0; b < LoopMetrics::Buckets; b++) {
+            count += (loops[i].*buckets)[b];
+            auto le = b + 1 == LoopMetrics::Buckets
+                          ? std::string("+Inf")
+                          : std::to_string(LoopMetrics::bucket_bound(b) - 1);
+            metric(out, bucket, i, le, std::to_string(count));
+        }
+        metric(out, std::string(name) + "_sum", i, {}, std::to_string(sum(loops[i])));
+        metric(out, std::string(name) + "_count", i, {}, std::to_string(count));
+    }
+}
+
+} // namespace
+
+std::string render_prometheus(std::span<const LoopMetrics::Snapshot> loops) {
+    using S = LoopMetrics::Snapshot;
+    std::string out;
+    scalar(out, loops, "polls_total", "counter", "Calls to epoll_pwait or pselect.", &S::polls);
+    scalar(out, loops, "events_total", "counter", "Ready fds returned by the polls.", &S::events);
+    scalar(out, loops, "blocked_nanoseconds_total", "counter", "Time spent waiting in the poll.",
+           &S::blocked_ns);
+    scalar(out, loops, "busy_nanoseconds_total", "counter", "Time spent handling ready fds.",
+           &S::busy_ns);
+    scalar(out, loops, "resumes_total", "counter", "Coroutines resumed by the poller and timers.",
+           &S::resumes);
+    scalar(out, loops, "timers_fired_total", "counter", "Timers that expired.", &S::timers_fired);
+    scalar(out, loops, "timers_cancelled_total", "counter", "Timers cancelled before expiring.",
+           &S::timers_cancelled);
+    scalar(out, loops, "fds", "gauge", "File descriptors registered with the poller.", &S::fds);
+    scalar(out, loops, "accepts_total", "counter", "accept4 calls.", &S::accepts);
+    scalar(out, loops, "connections_total", "counter", "Connections accepted.", &S::connections);
+    scalar(out, loops, "reads_total", "counter", "read and readv calls.", &S::reads);
+    scalar(out, loops, "read_bytes_total", "counter", "Bytes read.", &S::read_bytes);
+    scalar(out, loops, "writes_total", "counter", "write and writev calls.", &S::writes);
+    scalar(out, loops, "write_bytes_total", "counter", "Bytes written.", &S::write_bytes);
+    histogram(out, loops, "events_per_poll", "Ready fds returned by one poll.",
+              &S::events_per_poll, [](const S &s) { return s.events; });
+    histogram(out, loops, "busy_microseconds", "Time spent handling the fds of one poll.",
+              &S::busy_us, [](const S &s) { return s.busy_ns / 1000; });
+    return out;
+}
+
+} // namespace co_io
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace co_io {
+
+// Counters of one loop. Only the loop's thread writes them, so updates are plain relaxed
+// load + store without a locked instruction, and any thread can take a snapshot() at any
+// time without stopping the loop.
+class LoopMetrics {
+  public:
+    // powers of two: bucket 0 counts 0, bucket i counts [2^(i-1), 2^i), the last the rest
+    static constexpr size_t Buckets = 16;
+
+    struct Snapshot {
+        uint64_t polls = 0;      // epoll_pwait / pselect calls
+        uint64_t events = 0;     // ready fds they returned
+        uint64_t blocked_ns = 0; // time inside the wait
+        uint64_t busy_ns = 0;    // time handling what it returned
+        uint64_t resumes = 0;    // coroutines resumed by the poller and timers
+        uint64_t timers_fired = 0;
+        uint64_t timers_cancelled = 0;
+        uint64_t fds = 0; // registered right now
+        uint64_t accepts = 0;     // accept4 calls
+        uint64_t connections = 0; // sockets they returned
+        uint64_t reads = 0;       // read calls, also the ones that would block
+        uint64_t read_bytes = 0;
+        uint64_t writes = 0; // write calls
+        uint64_t write_bytes = 0;
+        std::array<uint64_t, Buckets> events_per_poll{}; // how many polls returned n events
+        std::array<uint64_t, Buckets> busy_us{};         // how many iterations were busy n us
+    };
+
+    static constexpr size_t bucket(uint64_t value) noexcept {
+        return std::min<size_t>(static_cast<size_t>(std::bit_width(value)), Buckets - 1);
+    }
+
+    // upper bound (exclusive) of bucket, the last one is unbounded
+    static constexpr uint64_t bucket_bound(size_t bucket) noexcept { return uint64_t{1} << bucket; }
+
+    void poll(uint64_t events, uint64_t blocked_ns, uint64_t busy_ns) noexcept {
+        add(polls_, 1);
+        add(events_, events);
+        add(blocked_ns_, blocked_ns);
+        add(busy_ns_, busy_ns);
+        add(events_per_poll_[bucket(events)], 1);
+        add(busy_us_[bucket(busy_ns / 1000)], 1);
+    }
+    void resumed(uint64_t count) noexcept { add(resumes_, count); }
+    void timer_fired() noexcept { add(timers_fired_, 1); }
+    void timer_cancelled() noexcept { add(timers_cancelled_, 1); }
+    void fd_registered() noexcept { add(fds_, 1); }
+    void fd_unregistered() noexcept {
+        fds_.store(fds_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+    // one accept4 call that returned count connections
+    void accepted(uint64_t count) noexcept {
+        add(accepts_, 1);
+        add(connections_, count);
+    }
+    void read(uint64_t bytes) noexcept {
+        add(reads_, 1);
+        add(read_bytes_, bytes);
+    }
+    void wrote(uint64_t bytes) noexcept {
+        add(writes_, 1);
+        add(write_bytes_, bytes);
+    }
+
+    // any thread
+    Snapshot snapshot() const noexcept;
+
+  private:
+    using Counter = std::atomic<uint64_t>;
+
+    static void add(Counter &counter, uint64_t n) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    Counter polls_{0};
+    Counter events_{0};
+    Counter blocked_ns_{0};
+    Counter busy_ns_{0};
+    Counter resumes_{0};
+    Counter timers_fired_{0};
+    Counter timers_cancelled_{0};
+    Counter fds_{0};
+    Counter accepts_{0};
+    Counter connections_{0};
+    Counter reads_{0};
+    Counter read_bytes_{0};
+    Counter writes_{0};
+    Counter write_bytes_{0};
+    std::array<Counter, Buckets> events_per_poll_{};
+    std::array<Counter, Buckets> busy_us_{};
+};
+
+// Prometheus text exposition of several loops, labelled loop="<index>".
+std::string render_prometheus(std::span<const LoopMetrics::Snapshot> loops);
+
+} // namespace co_io
@@ -1,9 +1,20 @@
 #include "io/poller.hpp"
 #include "utils/system_call.hpp"
+#include <chrono>
 #include <iostream>
 
 namespace co_io {
 
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nanos(Clock::duration duration) {
+    return static_cast<uint64_t>(std::chrono::nanoseconds(duration).count());
+}
+
+} // namespace
+
 void PollerBase::register_fd(int fd) {
     handles_.insert_or_assign(fd, PollerEvent{.fd = fd, .event = PollEvent::none()});
 }
@@ -80,17 +91,22 @@ void SelectPoller::poll() {
 
     fd_set read_set{read_set_}, write_set{write_set_};
 
+    auto start = Clock::now();
     int n = system_call(pselect(max_fd_ + 1, &read_set, &write_set, nullptr, nullptr, nullptr))
                 .execption("pselect");
+    auto woken = Clock::now();
+    uint64_t resumed = 0;
 
     if (n > 0) {
         for (auto it = handles_.begin(); it != handles_.end();) {
             int fd = it->first;
             if (FD_ISSET(fd, &read_set) && it->second.read_handle) {
                 it->second.read_handle();
+                resumed += 1;
             }
             if (FD_ISSET(fd, &write_set) && it->second.write_handle) {
                 it->second.write_handle();
+                resumed += 1;
             }
 
             if (!it->second.read_handle && !it->second.write_handle) {
@@ -109,6 +125,11 @@ void SelectPoller::poll() {
             }
         }
     }
+
+    if (metrics_) {
+        metrics_->resumed(resumed);
+        metrics_->poll(static_cast<uint64_t>(n), nanos(woken - start), nanos(Clock::now() - woken));
+    }
 }
 
 EPollPoller::EPollPoller()
@@ -164,21 +185,31 @@ void EPollPoller::unregister_fd(int fd) {
 }
 
 void EPollPoller::poll() {
+    auto start = Clock::now();
     int n = system_call(epoll_pwait(epoll_fd_, events_.data(), static_cast<int>(events_.size()), -1,
                                     nullptr))
                 .execption("epoll_pwait");
+    auto woken = Clock::now();
+    uint64_t resumed = 0;
 
     for (unsigned long i = 0; i < static_cast<unsigned long>(n); ++i) {
         auto &ev = events_[i];
         if (auto it = handles_.find(ev.data.fd); it != handles_.end()) {
             if (ev.events & EPOLLOUT && it->second.write_handle) {
                 it->second.write_handle();
+                resumed += 1;
             }
             if (ev.events & EPOLLIN && it->second.read_handle) {
                 it->second.read_handle();
+                resumed += 1;
             }
         }
     }
+
+    if (metrics_) {
+        metrics_->resumed(resumed);
+        metrics_->poll(static_cast<uint64_t>(n), nanos(woken - start), nanos(Clock::now() - woken));
+    }
 }
 
 } // namespace co_io
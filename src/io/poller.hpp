@@ -8,6 +8,7 @@
 #include <unordered_map>
 
 #include "coroutine/task.hpp"
+#include "io/loop_metrics.hpp"
 
 namespace co_io {
 
@@ -54,10 +55,14 @@ class PollerBase {
     virtual bool remove_event(int fd, PollEvent event);
     virtual void poll() = 0;
 
+    // poll() counts its iterations, events and resumed handles here when set
+    void set_metrics(LoopMetrics *metrics) noexcept { metrics_ = metrics; }
+
     virtual ~PollerBase() = default;
 
   protected:
     std::unordered_map<int, PollerEvent> handles_;
+    LoopMetrics *metrics_ = nullptr;
 };
 
 class SelectPoller : public PollerBase {
@@ -99,6 +104,9 @@ struct PollerPromise : public Promise<void> {
     PollerBase *poller_;
     PollEvent event_ = PollEvent::read();
 
+    PollerPromise(std::source_location where = std::source_location::current())
+        : Promise<void>(where) {}
+
     auto get_return_object() { return std::coroutine_handle<PollerPromise>::from_promise(*this); }
     inline ~PollerPromise() { poller_->remove_event(fd_, event_); }
 
@@ -109,15 +117,18 @@ struct PollerAwaiter {
     int fd_;
     PollerBase *poller_;
     PollEvent event_ = PollEvent::read();
+    [[no_unique_address]] TraceAwait trace_{};
 
     bool await_ready() const noexcept { return false; }
-    void await_suspend(std::coroutine_handle<PollerPromise> h) const {
+    void await_suspend(std::coroutine_handle<PollerPromise> h) {
+        trace_.suspend(h, event_ & PollEvent::write() ? trace::Wait::Write : trace::Wait::Read,
+                       nullptr, fd_);
         poller_->add_event(fd_, event_, h);
         h.promise().poller_ = poller_;
         h.promise().fd_ = fd_;
         h.promise().event_ = event_;
     }
-    void await_resume() const noexcept {}
+    void await_resume() const noexcept { trace_.resume(); }
 };
 
 inline Task<void, PollerPromise> waiting_for_event(PollerBase *poller, int fd, PollEvent event) {
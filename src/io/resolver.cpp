@@ -0,0 +1,162 @@
+#include "io/resolver.hpp"
+#include "io/loop.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <netdb.h>
+#include <sys/eventfd.h>
+
+namespace co_io {
+
+std::error_category const &resolver_category() {
+    static struct : std::error_category {
+        char const *name() const noexcept override { return "getaddrinfo"; }
+        std::string message(int err) const override { return ::gai_strerror(err); }
+    } instance;
+    return instance;
+}
+
+namespace {
+
+// failures that are about the moment rather than the name are asked again next time
+bool cacheable(int error) {
+    return error != EAI_AGAIN && error != EAI_SYSTEM && error != EAI_MEMORY;
+}
+
+} // namespace
+
+Resolver::Resolver(Options options, Lookup lookup)
+    : options_(options), lookup_(std::move(lookup)) {
+    for (size_t i = 0; i < std::max<size_t>(options_.threads, 1); i++) {
+        threads_.emplace_back([this](std::stop_token stop) { work(stop); });
+    }
+}
+
+Resolver::~Resolver() = default;
+
+Resolver &Resolver::global() {
+    static Resolver resolver;
+    return resolver;
+}
+
+int Resolver::system_lookup(const std::string &host, const std::string &port,
+                            std::vector<Address> &out) {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    addrinfo *result = nullptr;
+    int err = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (err != 0) {
+        return err;
+    }
+    for (auto *info = result; info != nullptr; info = info->ai_next) {
+        Address addr{};
+        std::memcpy(&addr.addr_storage_, info->ai_addr, info->ai_addrlen);
+        addr.len_ = info->ai_addrlen;
+        out.push_back(addr);
+    }
+    ::freeaddrinfo(result);
+    return 0;
+}
+
+void Resolver::clear() {
+    std::lock_guard lock(mutex_);
+    cache_.clear();
+}
+
+// with mutex_ held
+bool Resolver::cached(const std::string &key, Entry &entry) {
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        return false;
+    }
+    if (it->second.expires <= std::chrono::steady_clock::now()) {
+        cache_.erase(it);
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+std::vector<Resolver::Address> Resolver::answer(const Entry &entry, const std::string &host) {
+    if (entry.error != 0) {
+        throw std::system_error(entry.error, resolver_category(), host);
+    }
+    return entry.addresses;
+}
+
+Task<std::vector<Resolver::Address>> Resolver::resolve(LoopBase *loop, std::string host,
+                                                       std::string port) {
+    std::string key = host + ":" + port;
+    std::shared_ptr<Job> job;
+    int fd = -1;
+    {
+        std::lock_guard lock(mutex_);
+        Entry entry;
+        if (cached(key, entry)) {
+            co_return answer(entry, host);
+        }
+        auto &slot = in_flight_[key];
+        if (!slot) {
+            slot = std::make_shared<Job>();
+            slot->host = host;
+            slot->port = port;
+            jobs_.push_back(slot);
+            wake_.notify_one();
+        }
+        job = slot;
+        fd = system_call(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)).execption("eventfd");
+        job->waiters.push_back(fd);
+    }
+
+    // The helper thread writes to the eventfd, so it leaves the job before it is closed,
+    // also when this coroutine is destroyed while it waits.
+    AsyncFile event = AsyncFile::adopt(fd, loop);
+    struct Leave {
+        Resolver *resolver;
+        Job *job;
+        int fd;
+        ~Leave() {
+            std::lock_guard lock(resolver->mutex_);
+            std::erase(job->waiters, fd);
+        }
+    } leave{this, job.get(), fd};
+
+    uint64_t count = 0;
+    (co_await event.async_read(&count, sizeof(count))).execption("eventfd read");
+    std::lock_guard lock(mutex_);
+    co_return answer(job->result, host);
+}
+
+void Resolver::work(std::stop_token stop) {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock lock(mutex_);
+            if (!wake_.wait(lock, stop, [this] { return !jobs_.empty(); })) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        Entry result;
+        result.error = lookup_(job->host, job->port, result.addresses);
+        result.expires = std::chrono::steady_clock::now() +
+                         (result.error == 0 ? options_.ttl : options_.negative_ttl);
+
+        std::string key = job->host + ":" + job->port;
+        std::lock_guard lock(mutex_);
+        if (result.error == 0 || cacheable(result.error)) {
+            cache_[key] = result;
+        }
+        in_flight_.erase(key);
+        job->result = std::move(result);
+        uint64_t one = 1;
+        for (int fd : job->waiters) {
+            system_call(::write(fd, &one, sizeof(one)));
+        }
+    }
+}
+
+} // namespace co_io
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+
+namespace co_io {
+
+std::error_category const &resolver_category();
+
+// Name resolution for coroutines: getaddrinfo blocks, so it runs on helper threads while
+// the loop goes on. Answers are cached for every loop of the process, failures too.
+// getaddrinfo does not report the TTL of the records, the cache keeps answers for
+// Options::ttl and failures for Options::negative_ttl.
+class Resolver {
+  public:
+    using Address = AddressSolver::Address;
+    // 0 with the addresses in out, or an EAI_* error
+    using Lookup = std::function<int(const std::string &host, const std::string &port,
+                                     std::vector<Address> &out)>;
+
+    struct Options {
+        std::chrono::milliseconds ttl{30000};
+        std::chrono::milliseconds negative_ttl{5000};
+        // lookups that run at once, a slow name server stalls one each
+        size_t threads = 2;
+    };
+
+    Resolver() : Resolver(Options{}) {}
+    explicit Resolver(Options options, Lookup lookup = system_lookup);
+    ~Resolver();
+
+    Resolver(const Resolver &) = delete;
+    Resolver &operator=(const Resolver &) = delete;
+
+    // the process wide resolver, with getaddrinfo
+    static Resolver &global();
+
+    // From a coroutine of any loop. Cached answers come back without suspending, a lookup
+    // already running for host and port is shared. Throws std::system_error with the EAI_*
+    // code in resolver_category().
+    Task<std::vector<Address>> resolve(LoopBase *loop, std::string host, std::string port);
+
+    void clear();
+
+    // getaddrinfo for stream sockets, in its order
+    static int system_lookup(const std::string &host, const std::string &port,
+                             std::vector<Address> &out);
+
+  private:
+    struct Entry {
+        std::vector<Address> addresses;
+        int error = 0;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    // a lookup in flight, waiters are eventfds registered on their loops
+    struct Job {
+        std::string host;
+        std::string port;
+        Entry result;
+        std::vector<int> waiters;
+    };
+
+    Options options_;
+    Lookup lookup_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> cache_;                   // by host:port
+    std::unordered_map<std::string, std::shared_ptr<Job>> in_flight_; // by host:port
+    std::deque<std::shared_ptr<Job>> jobs_;
+    std::condition_variable_any wake_;
+    std::vector<std::jthread> threads_; // last, they stop before the rest goes
+
+    bool cached(const std::string &key, Entry &entry);
+    void work(std::stop_token stop);
+    static std::vector<Address> answer(const Entry &entry, const std::string &host);
+};
+
+} // namespace co_io
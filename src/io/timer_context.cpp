@@ -1,5 +1,6 @@
 #include "io/timer_context.hpp"
 #include "coroutine/task.hpp"
+#include "io/loop.hpp"
 #include <iostream>
 
 namespace co_io {
@@ -15,7 +16,10 @@ uint32_t TimerContext::add_timer(std::chrono::steady_clock::time_point expired_t
     return next_timer_id_;
 }
 
-void TimerContext::cancel_timer(uint64_t id) { cancel_timers_.insert(id); }
+void TimerContext::cancel_timer(uint64_t id) {
+    cancel_timers_.insert(id);
+    clock_fd_.loop()->metrics()->timer_cancelled();
+}
 
 void TimerContext::reset() {
     while (!cancel_timers_.empty() && !timers_.empty()) { // remove cancel timer
@@ -49,6 +53,7 @@ void TimerContext::reset() {
 }
 
 Task<void> TimerContext::poll_timer() {
+    auto *metrics = clock_fd_.loop()->metrics();
     while (!stop_) {
         uint64_t exp = 0;
         co_await clock_fd_.async_read(reinterpret_cast<void *>(&exp), sizeof(exp));
@@ -56,13 +61,17 @@ Task<void> TimerContext::poll_timer() {
             break;
         }
 
-        while (!timers_.empty() && timers_.top().expired_time <= std::chrono::steady_clock::now()) {
+        // a callback may stop the loop, the stop entry has no coroutine to resume
+        while (!stop_ && !timers_.empty() &&
+               timers_.top().expired_time <= std::chrono::steady_clock::now()) {
             auto top = timers_.top();
             timers_.pop();
             if (cancel_timers_.find(top.id) != cancel_timers_.end()) {
                 cancel_timers_.erase(top.id);
                 continue;
             }
+            metrics->timer_fired();
+            metrics->resumed(1);
             top.callback();
         }
         reset();
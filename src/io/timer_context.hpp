@@ -58,6 +58,9 @@ class TimerContext {
         uint32_t timer_id_;
         bool completed = false;
 
+        TimerPromise(std::source_location where = std::source_location::current())
+            : Promise<void>(where) {}
+
         auto get_return_object() {
             return std::coroutine_handle<TimerPromise>::from_promise(*this);
         }
@@ -78,12 +81,17 @@ class TimerContext {
             auto &promise = h.promise();
             promise.timer_context = timer_context_;
             promise.timer_id_ = timer_context_->add_timer(expired_time_, h);
+            trace_.suspend(h, trace::Wait::Timer, nullptr, promise.timer_id_);
+        }
+        void await_resume() const noexcept {
+            trace_.resume();
+            handle_.promise().completed = true;
         }
-        void await_resume() const noexcept { handle_.promise().completed = true; }
 
         std::chrono::steady_clock::time_point expired_time_;
         TimerContext *timer_context_;
         std::coroutine_handle<TimerPromise> handle_{};
+        [[no_unique_address]] TraceAwait trace_{};
     };
 
     inline Task<void, TimerPromise>
@@ -5,132 +5,354 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <span>
 #include <stack>
+#include <string>
 #include <string_view>
-
-template <typename Value> class AdaptiveRadixTree {
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "utils/art_key.hpp"
+#include "utils/inline_stack.hpp"
+#include "utils/slab_pool.hpp"
+
+// Key is any type with ArtKeyTraits, by default byte strings.
+template <typename Value, template <typename> class Pool = HeapPool,
+          typename Key = std::string_view>
+class AdaptiveRadixTree {
     struct Node;
     struct Node4;
     struct Node16;
     struct Node48;
     struct Node256;
+    enum class NodeType : uint8_t { N4, N16, N48, N256 };
 
   public:
+    using KeyTraits = ArtKeyTraits<Key>;
+    using KeyArg = typename KeyTraits::Arg;
     struct Leaf;
 
-    AdaptiveRadixTree() = default;
+    AdaptiveRadixTree() : root(create<Node4>("")) {}
     AdaptiveRadixTree(const AdaptiveRadixTree &other) = delete;
     AdaptiveRadixTree &operator=(const AdaptiveRadixTree &other) = delete;
 
-    AdaptiveRadixTree(const AdaptiveRadixTree &&other) = default;
-    AdaptiveRadixTree &operator=(AdaptiveRadixTree &&other) = default;
-    ~AdaptiveRadixTree() { delete root; }
+    AdaptiveRadixTree(AdaptiveRadixTree &&other) noexcept
+        : pools_(std::move(other.pools_)), root(std::exchange(other.root, nullptr)) {}
+    AdaptiveRadixTree &operator=(AdaptiveRadixTree &&other) noexcept {
+        std::swap(pools_, other.pools_);
+        std::swap(root, other.root);
+        return *this;
+    }
+    ~AdaptiveRadixTree() {
+        if (root) {
+            destroy_tree(root);
+        }
+    }
 
-    void insert(std::string_view key, Value value);
-    std::optional<Value> search(std::string_view key);
-    bool remove(std::string_view key);
+    void insert(KeyArg key, Value value);
+    std::optional<Value> search(KeyArg key) const;
+
+    // Pointer to the value stored for key, nullptr when missing. Valid until the key is
+    // removed or the tree is destroyed, values are never copied on this path.
+    Value *find(KeyArg key);
+    const Value *find(KeyArg key) const;
+
+    // Moves value into the tree, the bool is false when an existing value was assigned.
+    template <typename V>
+    std::pair<Value *, bool> insert_or_assign(KeyArg key, V &&value);
+    // Constructs the value in its leaf from args, an existing value is left untouched and
+    // the bool is false.
+    template <typename... Args>
+    std::pair<Value *, bool> emplace(KeyArg key, Args &&...args);
+    bool remove(KeyArg key);
+
+    // Looks up keys[i] into results[i], nullptr when missing. Keys are walked in groups in
+    // lock-step and each key's next node is prefetched while the others take their step,
+    // so cache misses overlap instead of stalling every level of every lookup.
+    void search_batch(std::span<const KeyArg> keys, std::span<Value *> results);
+
+    // Builds an empty tree bottom-up from (key, value) pairs sorted by key, every node is
+    // created once with its final size. With threads > 1 the subtrees under different
+    // first bytes are built concurrently. A non-empty tree falls back to insert.
+    template <std::random_access_iterator It>
+    void bulk_load(It first, It last, size_t threads = 1);
+
+    // Shape and memory use of the tree, see Stats.
+    struct Stats;
+    Stats stats() const;
 
     void debug();
     class Iterator;
+    struct Range;
     Iterator begin();
     Iterator end();
+    std::reverse_iterator<Iterator> rbegin() { return std::reverse_iterator<Iterator>(end()); }
+    std::reverse_iterator<Iterator> rend() { return std::reverse_iterator<Iterator>(begin()); }
+
+    // Ordered lookups, keys compare by their encoding, bytewise as unsigned chars like
+    // std::string does. They seek down a single root to leaf path instead of scanning leaves.
+    Iterator lower_bound(KeyArg key);           // first key >= key
+    Iterator upper_bound(KeyArg key);           // first key > key
+    Range range(KeyArg from, KeyArg to);        // keys in [from, to)
+    Range scan_prefix(std::string_view prefix); // keys whose encoding starts with prefix
 
     class Iterator {
+        friend class AdaptiveRadixTree;
+
+        // a node on the path and the slot of the child visited below it, NoSlot while
+        // the iterator sits on the node's own leaf
+        struct Frame {
+            Node *node;
+            int slot;
+        };
+        static constexpr size_t InlineDepth = 32;
+
       public:
-        using iterator_category = std::forward_iterator_tag;
+        using iterator_category = std::bidirectional_iterator_tag;
         using difference_type = std::ptrdiff_t;
         using value_type = Leaf;
         using pointer = value_type *;
         using reference = value_type &;
 
         Iterator() = default;
-        explicit Iterator(Node *node) {
-            stack.push(node);
-            if (!next_leaf(0)) { // empty tree
-                stack = std::stack<Node *>();
-            }
+        explicit Iterator(Node *node) : root_(node) {
+            push(node);
+            first_leaf();
         }
 
-        reference operator*() {
+        reference operator*() const {
             assert(stack.size() > 0);
-            return *stack.top()->leaf_;
+            return *stack.top().node->leaf_;
         }
 
-        pointer operator->() {
+        pointer operator->() const {
             assert(stack.size() > 0);
-            return stack.top()->leaf_;
+            return stack.top().node->leaf_;
         }
 
         bool operator==(const Iterator &other) const {
             if (stack.size() != other.stack.size()) {
                 return false;
             }
-            if (stack.empty() || (stack.size() > 0 && stack.top() == other.stack.top())) {
-                return true;
-            }
-            return false;
+            return stack.empty() || stack.top().node == other.stack.top().node;
         }
 
         bool operator!=(const Iterator &other) const { return !(*this == other); }
 
         Iterator &operator++() {
             assert(stack.size() > 0);
-            uint16_t start_key = 0;
-            while (!stack.empty() && !next_leaf(start_key)) { // not new leaf, pop top
-                if (!stack.top()->prefix_.empty()) {          // non root node, only root
-                                                              // node prefix is empty
-                    uint16_t next_key = static_cast<uint16_t>(stack.top()->prefix_.front()) + 1;
-                    start_key = next_key;
-                }
+            if (!next_leaf()) { // no children, continue after the subtree
+                skip_subtree();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        // a node's own leaf comes before its children, the previous leaf is the last leaf
+        // under the previous sibling or else the parent's leaf
+        Iterator &operator--() {
+            if (stack.empty()) { // end()
+                push(root_);
+                last_leaf();
+                return *this;
+            }
+            while (stack.size() > 1) {
                 stack.pop();
+                Frame &top = stack.top();
+                if (int slot = prev_slot(top.node, top.slot); slot != NoSlot) {
+                    top.slot = slot;
+                    push(child_at(top.node, slot));
+                    last_leaf();
+                    return *this;
+                }
+                if (top.node->leaf_) {
+                    top.slot = NoSlot;
+                    return *this;
+                }
             }
+            stack.clear(); // was begin()
             return *this;
         }
 
-        // Iterator operator++(int) {
-        //   Iterator tmp = *this;
-        //   ++(*this);
-        //   return tmp;
-        // }
+        Iterator operator--(int) {
+            Iterator tmp = *this;
+            --(*this);
+            return tmp;
+        }
 
       private:
-        bool next_leaf(uint16_t start_key) {
-            assert(stack.size() > 0);
-            // std::cerr << stack.top().second->prefix << " " <<
-            // static_cast<char>(start_key) << std::endl;
-            bool new_leaf = false;
-            do {
-                Node *current = stack.top();
-                if (auto result = current->next_or_equal_key(start_key); result) {
-                    auto *next = result->first;
-                    stack.push(next);
-                    start_key = 0;
-                    new_leaf = true;
-                } else {
+        Iterator(Node *root, std::string_view key, bool inclusive) : root_(root) {
+            seek(key, inclusive);
+        }
+
+        void push(Node *node) { stack.push(Frame{node, NoSlot}); }
+
+        // descend into the child after the top's current slot, then down the first
+        // children to a leaf, false if there is no such child
+        bool next_leaf() {
+            Frame &top = stack.top();
+            int slot = next_slot(top.node, top.slot);
+            if (slot == NoSlot) {
+                return false;
+            }
+            top.slot = slot;
+            push(child_at(top.node, slot));
+            while (stack.top().node->leaf_ == nullptr) { // inner nodes always have children
+                Frame &current = stack.top();
+                current.slot = next_slot(current.node, NoSlot);
+                push(child_at(current.node, current.slot));
+            }
+            return true;
+        }
+
+        // the top node's leaf or the first leaf below it
+        void first_leaf() {
+            if (stack.top().node->leaf_ == nullptr && !next_leaf()) {
+                skip_subtree();
+            }
+        }
+
+        void last_leaf() {
+            while (true) {
+                Frame &top = stack.top();
+                int slot = prev_slot(top.node, end_slot(top.node));
+                if (slot == NoSlot) {
                     break;
                 }
-            } while (stack.top()->leaf_ == nullptr);
-            return new_leaf;
+                top.slot = slot;
+                push(child_at(top.node, slot));
+            }
+            if (stack.top().node->leaf_ == nullptr) { // empty tree
+                stack.clear();
+            }
         }
-        std::stack<Node *> stack;
+
+        // the top node's subtree is done, move to the first leaf after it
+        void skip_subtree() {
+            while (stack.size() > 1) {
+                stack.pop();
+                if (next_leaf()) {
+                    return;
+                }
+            }
+            stack.clear();
+        }
+
+        void seek(std::string_view key, bool inclusive) {
+            push(root_);
+            while (true) {
+                Node *current = stack.top().node;
+                size_t match_prefix = current->match(key);
+                if (current->prefix_.length() > match_prefix) {
+                    // key ends inside the prefix or is smaller at the first difference,
+                    // the whole subtree is after key
+                    if (match_prefix == key.length() ||
+                        static_cast<uint8_t>(current->prefix_[match_prefix]) >
+                            static_cast<uint8_t>(key[match_prefix])) {
+                        first_leaf();
+                    } else {
+                        skip_subtree();
+                    }
+                    return;
+                }
+                key.remove_prefix(match_prefix);
+                if (key.empty()) { // exact match, children are all greater
+                    if ((!inclusive || current->leaf_ == nullptr) && !next_leaf()) {
+                        skip_subtree();
+                    }
+                    return;
+                }
+                auto byte = static_cast<uint8_t>(key[0]);
+                int slot = lower_slot(current, byte);
+                if (slot == NoSlot) {
+                    skip_subtree();
+                    return;
+                }
+                stack.top().slot = slot;
+                push(child_at(current, slot));
+                if (slot_key(current, slot) != byte) {
+                    first_leaf();
+                    return;
+                }
+            }
+        }
+
+        Node *root_ = nullptr;
+        InlineStack<Frame, InlineDepth> stack;
+    };
+
+    struct Range {
+        Iterator first;
+        Iterator last;
+
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
     };
 
   private:
-    Node *root = new Node4{""};
+    template <typename T, typename... Args> T *create(Args &&...args) {
+        return std::get<Pool<T>>(pools_).create(std::forward<Args>(args)...);
+    }
+    template <typename T> void destroy(T *ptr) noexcept { std::get<Pool<T>>(pools_).destroy(ptr); }
+
+    // Children addressed by slot, the index into keys_ for Node4/Node16 and the key byte
+    // for Node48/Node256. Slots grow with the key, NoSlot is before the first one.
+    static constexpr int NoSlot = -1;
+    static int end_slot(const Node *node) noexcept;
+    static int next_slot(const Node *node, int slot) noexcept; // first occupied after slot
+    static int prev_slot(const Node *node, int slot) noexcept; // last occupied before slot
+    static int lower_slot(const Node *node, uint8_t key) noexcept; // first with key >= key
+    static uint8_t slot_key(const Node *node, int slot) noexcept;
+    static Node *child_at(const Node *node, int slot) noexcept;
+
+    void collect_stats(const Node *node, size_t depth, Stats &stats, size_t &childs) const;
+    static size_t heap_bytes(const std::string &str) noexcept;
+
+    void destroy_node(Node *node) noexcept; // node and its leaf, children are left alone
+    void destroy_tree(Node *node) noexcept; // whole subtree
+    Node *grow(Node *node);
+    Node *shrink(Node *node);
+    Node *insert_path(std::string_view key); // node the key ends at, created if missing
+    Value *find_encoded(std::string_view key);
+    bool remove_encoded(std::string_view key);
+
+    template <typename T> static typename KeyTraits::Encoded key_of(const T &item) {
+        const auto &[key, value] = item;
+        return KeyTraits::encode(key);
+    }
+    Node *make_node(size_t childs, std::string_view prefix);
+    template <typename It> It take_leaf(It first, It last, size_t length, Leaf *&leaf);
+    template <typename It> static It group_end(It first, It last, size_t depth);
+    template <typename It> Node *build(It first, It last, size_t depth, bool is_root);
+    template <typename It> Node *build_parallel(It first, It last, size_t threads);
+
+    std::tuple<Pool<Node4>, Pool<Node16>, Pool<Node48>, Pool<Node256>, Pool<Leaf>> pools_;
+    Node *root = nullptr;
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Node {
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Node {
     static constexpr size_t MaxChilds = 256;
     std::string prefix_;
     size_t size_ = 0;
     Leaf *leaf_{};
+    const NodeType type_;
 
-    explicit Node(std::string_view prefix) : prefix_(prefix) {}
-    Node(Node &&node) noexcept
-        : prefix_(std::move(node.prefix_)), size_(node.size_), leaf_(node.leaf_) {
+    Node(std::string_view prefix, NodeType type) : prefix_(prefix), type_(type) {}
+    Node(Node &&node, NodeType type) noexcept
+        : prefix_(std::move(node.prefix_)), size_(node.size_), leaf_(node.leaf_), type_(type) {
         node.size_ = 0;
         node.prefix_.clear();
         node.leaf_ = nullptr;
@@ -165,10 +387,9 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node {
         }
     }
 
-    Node() = default;
     Node(const Node &) = delete;
     Node &operator=(const Node &) = delete;
-    virtual ~Node() { delete leaf_; }
+    virtual ~Node() = default;
 
     [[nodiscard]] virtual size_t size() const noexcept { return size_; }
     [[nodiscard]] virtual bool is_full() const noexcept = 0;
@@ -182,19 +403,48 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node {
     prev_or_equal_key(size_t key) const noexcept = 0;
     virtual std::optional<std::pair<Node *, uint8_t>> first_key() const noexcept = 0;
     virtual std::optional<std::pair<Node *, uint8_t>> last_key() const noexcept = 0;
-    virtual Node *move() = 0;
-    virtual Node *grow() = 0;
-    virtual Node *shrink() = 0;
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Leaf {
-    std::string key;
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Leaf {
+    typename KeyTraits::Stored key; // the native key for fixed size encodings
     Value value;
 
-    explicit Leaf(std::string_view key, Value val) : key(key), value(std::move(val)) {}
+    explicit Leaf(std::string_view key, Value val)
+        : key(KeyTraits::decode(key)), value(std::move(val)) {}
+    template <typename... Args>
+    Leaf(std::string_view key, std::in_place_t, Args &&...args)
+        : key(KeyTraits::decode(key)), value(std::forward<Args>(args)...) {}
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Node4 : public Node {
+// Bytes count the node and leaf objects plus the memory their prefixes and keys allocate,
+// pools may hold more in free slots. Depth is the number of nodes from the root down to
+// the node holding the leaf, the root's own leaf has depth 0.
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Stats {
+    static constexpr size_t PrefixBuckets = 9; // prefix lengths 0 to 7, the last 8 and longer
+
+    std::array<size_t, 4> nodes{}; // Node4, Node16, Node48, Node256
+    size_t leaves = 0;
+    size_t node_bytes = 0;
+    size_t prefix_bytes = 0; // prefixes too long for the inline string buffer
+    size_t leaf_bytes = 0;
+    size_t key_bytes = 0; // leaf keys stored outside the leaf
+    size_t max_depth = 0;
+    double avg_depth = 0;
+    std::array<size_t, PrefixBuckets> prefix_lengths{};
+    double fill_factor = 0; // children over child slots, over all nodes
+
+    [[nodiscard]] size_t total_nodes() const noexcept {
+        return nodes[0] + nodes[1] + nodes[2] + nodes[3];
+    }
+    [[nodiscard]] size_t total_bytes() const noexcept {
+        return node_bytes + prefix_bytes + leaf_bytes + key_bytes;
+    }
+};
+
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Node4 : public Node {
     friend struct Node16;
 
     constexpr static size_t SIZE = 4;
@@ -203,9 +453,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node4 : public Node {
 
     Node4(const Node4 &) = delete;
     Node4 &operator=(const Node4 &) = delete;
-    explicit Node4(std::string_view prefix) : Node(prefix) {}
+    explicit Node4(std::string_view prefix) : Node(prefix, NodeType::N4) {}
     Node4(Node4 &&node) noexcept
-        : Node(std::move(node)), keys_(std::move(node.keys_)), childs_(std::move(node.childs_)) {
+        : Node(std::move(node), NodeType::N4), keys_(std::move(node.keys_)),
+          childs_(std::move(node.childs_)) {
         node.childs_.fill(nullptr);
     }
     Node4 &operator=(Node4 &&node) noexcept {
@@ -218,12 +469,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node4 : public Node {
     }
     explicit Node4(Node16 &&node);
 
-    ~Node4() override {
-        for (uint8_t i = 0; i < Node::size(); i++) {
-            delete childs_[i];
-        }
-    }
-
     [[nodiscard]] bool is_full() const noexcept override { return Node::size() == SIZE; }
     [[nodiscard]] bool should_shrink() const noexcept override { return false; }
     bool insert(uint8_t key, Node *node) override {
@@ -250,7 +495,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node4 : public Node {
         if (index == Node::Node::size() || keys_[index] != key) {
             return;
         }
-        delete childs_[index];
         for (size_t i = index; i < Node::Node::size() - 1; i++) {
             keys_[i] = keys_[i + 1];
             childs_[i] = childs_[i + 1];
@@ -304,13 +548,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node4 : public Node {
         return std::make_optional(
             std::make_pair(childs_[Node::size() - 1], keys_[Node::size() - 1]));
     }
-
-    Node *move() override { return new Node4(std::move(*this)); }
-    Node *shrink() override;
-    Node *grow() override;
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Node16 : public Node {
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Node16 : public Node {
     friend struct Node4;
     friend struct Node48;
 
@@ -320,9 +561,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node16 : public Node
 
     Node16(const Node16 &) = delete;
     Node16 &operator=(const Node16 &) = delete;
-    explicit Node16(std::string_view prefix) : Node(prefix) {}
+    explicit Node16(std::string_view prefix) : Node(prefix, NodeType::N16) {}
     Node16(Node16 &&node) noexcept
-        : Node(std::move(node)), keys_(std::move(node.keys_)), childs_(std::move(node.childs_)) {
+        : Node(std::move(node), NodeType::N16), keys_(std::move(node.keys_)),
+          childs_(std::move(node.childs_)) {
         node.childs_.fill(nullptr);
     }
     Node16 &operator=(Node16 &&node) noexcept {
@@ -335,11 +577,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node16 : public Node
     }
     explicit Node16(Node4 &&node);
     explicit Node16(Node48 &&node);
-    ~Node16() override {
-        for (uint8_t i = 0; i < Node::size(); i++) {
-            delete childs_[i];
-        }
-    }
 
     [[nodiscard]] bool is_full() const noexcept override { return Node::size() == SIZE; }
     [[nodiscard]] bool should_shrink() const noexcept override {
@@ -367,7 +604,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node16 : public Node
         if (index == Node::size() || keys_[index] != key) {
             return;
         }
-        delete childs_[index];
         for (size_t i = index; i < Node::size() - 1; i++) {
             keys_[i] = keys_[i + 1];
             childs_[i] = childs_[i + 1];
@@ -421,13 +657,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node16 : public Node
         return std::make_optional(
             std::make_pair(childs_[Node::size() - 1], keys_[Node::size() - 1]));
     }
-
-    Node *move() override { return new Node16(std::move(*this)); }
-    Node *shrink() override;
-    Node *grow() override;
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Node48 : public Node {
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Node48 : public Node {
     friend struct Node16;
     friend struct Node256;
     static constexpr int SIZE = 48;
@@ -436,9 +669,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node48 : public Node
 
     Node48(const Node48 &) = delete;
     Node48 &operator=(const Node48 &) = delete;
-    explicit Node48(std::string_view prefix) : Node(prefix) { keys_.fill(SIZE); }
+    explicit Node48(std::string_view prefix) : Node(prefix, NodeType::N48) { keys_.fill(SIZE); }
     Node48(Node48 &&node) noexcept
-        : Node(std::move(node)), keys_(std::move(node.keys_)), childs_(std::move(node.childs_)) {
+        : Node(std::move(node), NodeType::N48), keys_(std::move(node.keys_)),
+          childs_(std::move(node.childs_)) {
         node.keys_.fill(SIZE);
         node.childs_.fill(nullptr);
     }
@@ -452,11 +686,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node48 : public Node
     }
     explicit Node48(Node16 &&node);
     explicit Node48(Node256 &&node);
-    ~Node48() {
-        for (uint8_t i = 0; i < Node::size(); i++) {
-            delete childs_[i];
-        }
-    }
 
     [[nodiscard]] bool is_full() const noexcept override { return Node::size() == SIZE; }
     [[nodiscard]] bool should_shrink() const noexcept override {
@@ -480,7 +709,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node48 : public Node
     void remove(uint8_t key) override {
         if (uint8_t index = keys_[key]; index != SIZE) {
             keys_[key] = SIZE;
-            delete childs_[index];
             childs_[index] = nullptr;
             Node::size_ -= 1;
         }
@@ -522,37 +750,29 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node48 : public Node
     std::optional<std::pair<Node *, uint8_t>> last_key() const noexcept override {
         return prev_or_equal_key(Node::MaxChilds - 1);
     }
-
-    Node *move() override { return new Node48(std::move(*this)); }
-    Node *shrink() override;
-    Node *grow() override;
 };
 
-template <typename Value> struct AdaptiveRadixTree<Value>::Node256 : public Node {
+template <typename Value, template <typename> class Pool, typename Key>
+struct AdaptiveRadixTree<Value, Pool, Key>::Node256 : public Node {
     friend struct Node48;
     static constexpr int SIZE = 256;
     std::array<Node *, SIZE> childs_{};
-    uint8_t size_{};
 
     Node256(const Node256 &) = delete;
     Node256 &operator=(const Node256 &) = delete;
-    explicit Node256(std::string_view prefix) : Node(prefix) {}
-    Node256(Node256 &&node) noexcept : Node(std::move(node)), childs_(std::move(node.childs_)) {
+    explicit Node256(std::string_view prefix) : Node(prefix, NodeType::N256) {}
+    Node256(Node256 &&node) noexcept
+        : Node(std::move(node), NodeType::N256), childs_(std::move(node.childs_)) {
         node.childs_.fill(nullptr);
     }
     Node256 &operator=(Node256 &&node) noexcept {
         std::swap(Node::prefix_, node.prefix_);
         std::swap(Node::leaf_, node.leaf_);
+        std::swap(Node::size_, node.size_);
         std::swap(childs_, node.childs_);
-        std::swap(size_, node.size_);
         return *this;
     }
     explicit Node256(Node48 &&node);
-    ~Node256() {
-        for (size_t i = 0; i < SIZE && Node::size() > 0; i++) {
-            delete childs_[i];
-        }
-    }
 
     [[nodiscard]] bool is_full() const noexcept override { return Node::size() == SIZE; }
     [[nodiscard]] bool should_shrink() const noexcept override {
@@ -569,7 +789,6 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node256 : public Node
 
     void remove(uint8_t key) override {
         if (childs_[key] != nullptr) {
-            delete childs_[key];
             childs_[key] = nullptr;
             Node::size_ -= 1;
         }
@@ -611,14 +830,10 @@ template <typename Value> struct AdaptiveRadixTree<Value>::Node256 : public Node
     std::optional<std::pair<Node *, uint8_t>> last_key() const noexcept override {
         return prev_or_equal_key(Node::MaxChilds - 1);
     }
-
-    Node *move() override { return new Node256(std::move(*this)); }
-    Node *shrink() override;
-    Node *grow() override;
 };
 
-template <typename Value>
-AdaptiveRadixTree<Value>::Node4::Node4(Node16 &&node) : Node4("") { // 16 -> 4
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node4::Node4(Node16 &&node) : Node4("") { // 16 -> 4
     assert(node.size_ <= SIZE);
     Node::prefix_ = std::move(node.prefix_);
     std::copy_n(node.keys_.begin(), std::min(SIZE, node.size()), keys_.begin());
@@ -630,18 +845,8 @@ AdaptiveRadixTree<Value>::Node4::Node4(Node16 &&node) : Node4("") { // 16 -> 4
     node.size_ = 0;
 }
 
-template <typename Value> AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node4::grow() {
-    return new Node16(std::move(*this));
-}
-
-template <typename Value>
-AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node4::shrink() {
-    assert(false);
-    return nullptr;
-}
-
-template <typename Value>
-AdaptiveRadixTree<Value>::Node16::Node16(Node4 &&node) : Node16("") { // 4 -> 16
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node16::Node16(Node4 &&node) : Node16("") { // 4 -> 16
     Node::prefix_ = std::move(node.prefix_);
     std::copy_n(node.keys_.begin(), std::min(SIZE, node.size()), keys_.begin());
     std::copy_n(node.childs_.begin(), std::min(SIZE, node.size()), childs_.begin());
@@ -652,8 +857,8 @@ AdaptiveRadixTree<Value>::Node16::Node16(Node4 &&node) : Node16("") { // 4 -> 16
     node.size_ = 0;
 }
 
-template <typename Value>
-AdaptiveRadixTree<Value>::Node16::Node16(Node48 &&node) : Node16("") { // 48 -> 16
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node16::Node16(Node48 &&node) : Node16("") { // 48 -> 16
     assert(node.size_ <= SIZE);
     Node::prefix_ = std::move(node.prefix_);
     size_t index = 0;
@@ -672,17 +877,8 @@ AdaptiveRadixTree<Value>::Node16::Node16(Node48 &&node) : Node16("") { // 48 ->
     node.size_ = 0;
 }
 
-template <typename Value> AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node16::grow() {
-    return new Node48(std::move(*this));
-}
-
-template <typename Value>
-AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node16::shrink() {
-    return new Node4(std::move(*this));
-}
-
-template <typename Value>
-AdaptiveRadixTree<Value>::Node48::Node48(Node16 &&node) : Node48("") { // 16 -> 48
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node48::Node48(Node16 &&node) : Node48("") { // 16 -> 48
     Node::prefix_ = std::move(node.prefix_);
     for (size_t i = 0; i < node.size(); ++i) {
         keys_[node.keys_[i]] = static_cast<uint8_t>(i);
@@ -695,15 +891,15 @@ AdaptiveRadixTree<Value>::Node48::Node48(Node16 &&node) : Node48("") { // 16 ->
     node.size_ = 0;
 }
 
-template <typename Value>
-AdaptiveRadixTree<Value>::Node48::Node48(Node256 &&node) : Node48("") { // 256 -> 48
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node48::Node48(Node256 &&node) : Node48("") { // 256 -> 48
     assert(node.size_ <= SIZE);
     Node::prefix_ = std::move(node.prefix_);
     uint8_t index = 0;
     for (size_t key = 0; key < Node::MaxChilds; ++key) {
-        if (childs_[key]) {
+        if (node.childs_[key]) {
             keys_[key] = index;
-            childs_[index] = childs_[key];
+            childs_[index] = node.childs_[key];
             index += 1;
         }
     }
@@ -714,16 +910,8 @@ AdaptiveRadixTree<Value>::Node48::Node48(Node256 &&node) : Node48("") { // 256 -
     node.size_ = 0;
 }
 
-template <typename Value> AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node48::grow() {
-    return new Node256(std::move(*this));
-}
-template <typename Value>
-AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node48::shrink() {
-    return new Node16(std::move(*this));
-}
-
-template <typename Value>
-AdaptiveRadixTree<Value>::Node256::Node256(Node48 &&node) : Node256("") { // 48 -> 256
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node256::Node256(Node48 &&node) : Node256("") { // 48 -> 256
     Node::prefix_ = std::move(node.prefix_);
     for (size_t key = 0; key < Node::MaxChilds; ++key) {
         Node **child = node.find(key);
@@ -738,21 +926,204 @@ AdaptiveRadixTree<Value>::Node256::Node256(Node48 &&node) : Node256("") { // 48
     node.size_ = 0;
 }
 
-template <typename Value>
-AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node256::grow() {
-    assert(false);
-    return nullptr;
+template <typename Value, template <typename> class Pool, typename Key>
+int AdaptiveRadixTree<Value, Pool, Key>::end_slot(const Node *node) noexcept {
+    switch (node->type_) {
+    case NodeType::N4:
+    case NodeType::N16:
+        return static_cast<int>(node->size_);
+    case NodeType::N48:
+    case NodeType::N256:
+        break;
+    }
+    return static_cast<int>(Node::MaxChilds);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+int AdaptiveRadixTree<Value, Pool, Key>::next_slot(const Node *node, int slot) noexcept {
+    int end = end_slot(node);
+    switch (node->type_) {
+    case NodeType::N4:
+    case NodeType::N16:
+        return slot + 1 < end ? slot + 1 : NoSlot;
+    case NodeType::N48: {
+        const auto &keys = static_cast<const Node48 *>(node)->keys_;
+        for (slot += 1; slot < end; slot++) {
+            if (keys[slot] != Node48::SIZE) {
+                return slot;
+            }
+        }
+        return NoSlot;
+    }
+    case NodeType::N256:
+        break;
+    }
+    const auto &childs = static_cast<const Node256 *>(node)->childs_;
+    for (slot += 1; slot < end; slot++) {
+        if (childs[slot] != nullptr) {
+            return slot;
+        }
+    }
+    return NoSlot;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+int AdaptiveRadixTree<Value, Pool, Key>::prev_slot(const Node *node, int slot) noexcept {
+    switch (node->type_) {
+    case NodeType::N4:
+    case NodeType::N16:
+        return slot > 0 ? slot - 1 : NoSlot;
+    case NodeType::N48: {
+        const auto &keys = static_cast<const Node48 *>(node)->keys_;
+        for (slot -= 1; slot >= 0; slot--) {
+            if (keys[slot] != Node48::SIZE) {
+                return slot;
+            }
+        }
+        return NoSlot;
+    }
+    case NodeType::N256:
+        break;
+    }
+    const auto &childs = static_cast<const Node256 *>(node)->childs_;
+    for (slot -= 1; slot >= 0; slot--) {
+        if (childs[slot] != nullptr) {
+            return slot;
+        }
+    }
+    return NoSlot;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+int AdaptiveRadixTree<Value, Pool, Key>::lower_slot(const Node *node, uint8_t key) noexcept {
+    switch (node->type_) {
+    case NodeType::N4: {
+        const auto &keys = static_cast<const Node4 *>(node)->keys_;
+        auto slot = std::lower_bound(keys.begin(), keys.begin() + node->size_, key) - keys.begin();
+        return slot < end_slot(node) ? static_cast<int>(slot) : NoSlot;
+    }
+    case NodeType::N16: {
+        const auto &keys = static_cast<const Node16 *>(node)->keys_;
+        auto slot = std::lower_bound(keys.begin(), keys.begin() + node->size_, key) - keys.begin();
+        return slot < end_slot(node) ? static_cast<int>(slot) : NoSlot;
+    }
+    case NodeType::N48:
+    case NodeType::N256:
+        break;
+    }
+    return next_slot(node, static_cast<int>(key) - 1);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+uint8_t AdaptiveRadixTree<Value, Pool, Key>::slot_key(const Node *node, int slot) noexcept {
+    switch (node->type_) {
+    case NodeType::N4:
+        return static_cast<const Node4 *>(node)->keys_[slot];
+    case NodeType::N16:
+        return static_cast<const Node16 *>(node)->keys_[slot];
+    case NodeType::N48:
+    case NodeType::N256:
+        break;
+    }
+    return static_cast<uint8_t>(slot);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node *
+AdaptiveRadixTree<Value, Pool, Key>::child_at(const Node *node, int slot) noexcept {
+    switch (node->type_) {
+    case NodeType::N4:
+        return static_cast<const Node4 *>(node)->childs_[slot];
+    case NodeType::N16:
+        return static_cast<const Node16 *>(node)->childs_[slot];
+    case NodeType::N48: {
+        const auto *node48 = static_cast<const Node48 *>(node);
+        return node48->childs_[node48->keys_[slot]];
+    }
+    case NodeType::N256:
+        break;
+    }
+    return static_cast<const Node256 *>(node)->childs_[slot];
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::destroy_node(Node *node) noexcept {
+    if (node->leaf_) {
+        destroy<Leaf>(node->leaf_);
+    }
+    switch (node->type_) {
+    case NodeType::N4:
+        destroy<Node4>(static_cast<Node4 *>(node));
+        break;
+    case NodeType::N16:
+        destroy<Node16>(static_cast<Node16 *>(node));
+        break;
+    case NodeType::N48:
+        destroy<Node48>(static_cast<Node48 *>(node));
+        break;
+    case NodeType::N256:
+        destroy<Node256>(static_cast<Node256 *>(node));
+        break;
+    }
 }
 
-template <typename Value>
-AdaptiveRadixTree<Value>::Node *AdaptiveRadixTree<Value>::Node256::shrink() {
-    return new Node256(std::move(*this));
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::destroy_tree(Node *node) noexcept {
+    auto child = node->first_key();
+    while (child) {
+        destroy_tree(child->first);
+        child = node->next_or_equal_key(child->second + 1);
+    }
+    destroy_node(node);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node *AdaptiveRadixTree<Value, Pool, Key>::grow(Node *node) {
+    Node *new_node = nullptr;
+    switch (node->type_) {
+    case NodeType::N4:
+        new_node = create<Node16>(std::move(*static_cast<Node4 *>(node)));
+        break;
+    case NodeType::N16:
+        new_node = create<Node48>(std::move(*static_cast<Node16 *>(node)));
+        break;
+    case NodeType::N48:
+        new_node = create<Node256>(std::move(*static_cast<Node48 *>(node)));
+        break;
+    case NodeType::N256:
+        assert(false);
+        return node;
+    }
+    destroy_node(node);
+    return new_node;
 }
 
-template <typename Value> void AdaptiveRadixTree<Value>::insert(std::string_view key, Value value) {
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node *AdaptiveRadixTree<Value, Pool, Key>::shrink(Node *node) {
+    Node *new_node = nullptr;
+    switch (node->type_) {
+    case NodeType::N4:
+        assert(false);
+        return node;
+    case NodeType::N16:
+        new_node = create<Node4>(std::move(*static_cast<Node16 *>(node)));
+        break;
+    case NodeType::N48:
+        new_node = create<Node16>(std::move(*static_cast<Node48 *>(node)));
+        break;
+    case NodeType::N256:
+        new_node = create<Node48>(std::move(*static_cast<Node256 *>(node)));
+        break;
+    }
+    destroy_node(node);
+    return new_node;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node *
+AdaptiveRadixTree<Value, Pool, Key>::insert_path(std::string_view key) {
     Node *current = root;
     Node **parent = &root;
-    std::string_view remain = key;
     while (!key.empty()) {
         size_t match_prefix = current->match(key);
         // std::cerr << "commmon_prefix = "
@@ -765,28 +1136,20 @@ template <typename Value> void AdaptiveRadixTree<Value>::insert(std::string_view
         //                         key.length() - match_prefix)
         //     << std::endl;
         if (current->prefix_.length() > match_prefix) { // split at current node
-            Node *new_node = current->move();
-            current->prefix_ = new_node->prefix_.substr(0, match_prefix);
-            new_node->prefix_ = new_node->prefix_.substr(match_prefix);
-
-            current->prefix_ = current->prefix_.substr(0, match_prefix);
-            current->insert(static_cast<uint8_t>(new_node->prefix_[0]), new_node);
-            if (key.length() > match_prefix) {
-                current->insert(static_cast<uint8_t>(key[match_prefix]),
-                                new Node4{
-                                    key.substr(match_prefix),
-                                });
-            }
+            Node *split = create<Node4>(key.substr(0, match_prefix));
+            current->prefix_.erase(0, match_prefix);
+            split->insert(static_cast<uint8_t>(current->prefix_[0]), current);
+            *parent = split;
+            current = split;
         }
 
         key.remove_prefix(match_prefix);
         if (!key.empty() && current->find(key[0]) == nullptr) {
             if (current->is_full()) {
-                *parent = current->grow();
-                delete current;
+                *parent = grow(current);
                 current = *parent;
             }
-            current->insert(key[0], new Node4{key});
+            current->insert(key[0], create<Node4>(key));
         }
 
         if (!key.empty()) {
@@ -795,15 +1158,64 @@ template <typename Value> void AdaptiveRadixTree<Value>::insert(std::string_view
             current = *parent;
         }
     }
-    if (current->leaf_) {
-        current->leaf_->value = value;
-    } else {
-        current->leaf_ = new Leaf{remain, value};
+    return current;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::insert(KeyArg key, Value value) {
+    insert_or_assign(key, std::move(value));
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename V>
+std::pair<Value *, bool> AdaptiveRadixTree<Value, Pool, Key>::insert_or_assign(KeyArg key,
+                                                                               V &&value) {
+    auto encoded = KeyTraits::encode(key);
+    std::string_view bytes = KeyTraits::bytes(encoded);
+    Node *node = insert_path(bytes);
+    if (node->leaf_) {
+        node->leaf_->value = std::forward<V>(value);
+        return {&node->leaf_->value, false};
+    }
+    node->leaf_ = create<Leaf>(bytes, std::in_place, std::forward<V>(value));
+    return {&node->leaf_->value, true};
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename... Args>
+std::pair<Value *, bool> AdaptiveRadixTree<Value, Pool, Key>::emplace(KeyArg key,
+                                                                      Args &&...args) {
+    auto encoded = KeyTraits::encode(key);
+    std::string_view bytes = KeyTraits::bytes(encoded);
+    Node *node = insert_path(bytes);
+    if (node->leaf_) {
+        return {&node->leaf_->value, false};
+    }
+    node->leaf_ = create<Leaf>(bytes, std::in_place, std::forward<Args>(args)...);
+    return {&node->leaf_->value, true};
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+std::optional<Value> AdaptiveRadixTree<Value, Pool, Key>::search(KeyArg key) const {
+    if (const Value *value = find(key); value) {
+        return {*value};
     }
+    return std::nullopt;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+const Value *AdaptiveRadixTree<Value, Pool, Key>::find(KeyArg key) const {
+    return const_cast<AdaptiveRadixTree *>(this)->find(key);
 }
 
-template <typename Value>
-std::optional<Value> AdaptiveRadixTree<Value>::search(std::string_view key) {
+template <typename Value, template <typename> class Pool, typename Key>
+Value *AdaptiveRadixTree<Value, Pool, Key>::find(KeyArg key) {
+    auto encoded = KeyTraits::encode(key);
+    return find_encoded(KeyTraits::bytes(encoded));
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+Value *AdaptiveRadixTree<Value, Pool, Key>::find_encoded(std::string_view key) {
     Node *current = root;
     while (!key.empty()) {
         size_t match_prefix = current->match(key);
@@ -817,7 +1229,7 @@ std::optional<Value> AdaptiveRadixTree<Value>::search(std::string_view key) {
         //                               key.length() - match_prefix)
         //           << std::endl;
         if (current->prefix_.length() > match_prefix) { // prefix not complete match
-            return std::nullopt;
+            return nullptr;
         }
         key.remove_prefix(match_prefix);
         if (key.empty()) { // prefix complete match and remaining key is empty
@@ -826,16 +1238,71 @@ std::optional<Value> AdaptiveRadixTree<Value>::search(std::string_view key) {
         if (Node **next = current->find(key[0]); next) { // remaing key not next node to match
             current = *next;
         } else {
-            return std::nullopt;
+            return nullptr;
         }
     }
-    if (current->leaf_ != nullptr) {
-        return {current->leaf_->value};
+    return current->leaf_ ? &current->leaf_->value : nullptr;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::search_batch(std::span<const KeyArg> keys,
+                                                       std::span<Value *> results) {
+    assert(keys.size() == results.size());
+    constexpr size_t GroupSize = 16;
+    struct Lookup {
+        Node *node;
+        typename KeyTraits::Encoded encoded;
+        std::string_view key; // rest of the encoded key from node on
+    };
+    std::array<Lookup, GroupSize> group;
+
+    for (size_t base = 0; base < keys.size(); base += GroupSize) {
+        size_t count = std::min(GroupSize, keys.size() - base);
+        for (size_t i = 0; i < count; i++) {
+            group[i].node = root;
+            group[i].encoded = KeyTraits::encode(keys[base + i]);
+            group[i].key = KeyTraits::bytes(group[i].encoded);
+        }
+        size_t pending = count;
+        while (pending > 0) { // one level for every unfinished lookup per round
+            for (size_t i = 0; i < count; i++) {
+                Lookup &lookup = group[i];
+                if (lookup.node == nullptr) {
+                    continue;
+                }
+                Node *current = std::exchange(lookup.node, nullptr);
+                pending -= 1;
+                size_t match_prefix = current->match(lookup.key);
+                if (current->prefix_.length() > match_prefix) { // prefix not complete match
+                    results[base + i] = nullptr;
+                    continue;
+                }
+                lookup.key.remove_prefix(match_prefix);
+                if (lookup.key.empty()) {
+                    results[base + i] = current->leaf_ ? &current->leaf_->value : nullptr;
+                    continue;
+                }
+                Node **next = current->find(static_cast<uint8_t>(lookup.key[0]));
+                if (next == nullptr) {
+                    results[base + i] = nullptr;
+                    continue;
+                }
+                __builtin_prefetch(*next);
+                lookup.node = *next;
+                pending += 1;
+            }
+        }
     }
-    return std::nullopt;
 }
 
-template <typename Value> bool AdaptiveRadixTree<Value>::remove(std::string_view key) {
+template <typename Value, template <typename> class Pool, typename Key>
+bool AdaptiveRadixTree<Value, Pool, Key>::remove(KeyArg key) {
+    auto encoded = KeyTraits::encode(key);
+    return remove_encoded(KeyTraits::bytes(encoded));
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+bool AdaptiveRadixTree<Value, Pool, Key>::remove_encoded(std::string_view key) {
     Node **current = &root;
     std::stack<Node **> stack;
     while (!key.empty()) {
@@ -866,17 +1333,20 @@ template <typename Value> bool AdaptiveRadixTree<Value>::remove(std::string_view
         return false;
     }
 
-    delete (*current)->leaf_;
+    destroy<Leaf>((*current)->leaf_);
     (*current)->leaf_ = nullptr;
+    if (current == &root) {
+        return true;
+    }
     if ((*current)->size() == 0) {
         assert(stack.size() >= 2);
-        uint8_t k = (*current)->prefix_[0];
+        Node *empty = *current;
+        uint8_t k = empty->prefix_[0];
         stack.pop();
         (*stack.top())->remove(k);
+        destroy_node(empty);
         if ((*stack.top())->should_shrink()) {
-            Node* new_node = (*stack.top())->shrink();
-            delete (*stack.top());
-            *stack.top() = new_node;
+            *stack.top() = shrink(*stack.top());
         }
     }
 
@@ -892,23 +1362,268 @@ template <typename Value> bool AdaptiveRadixTree<Value>::remove(std::string_view
             // std::cerr << "next " << next->prefix_ << "\n";
 
             next->prefix_ = (*current)->prefix_ + next->prefix_;
-            (*current)->size_ = 0;
-            delete (*current);
+            destroy_node(*current);
             *current = next;
         }
     }
     return true;
 }
 
-template <typename Value> void AdaptiveRadixTree<Value>::debug() {
+template <typename Value, template <typename> class Pool, typename Key>
+template <std::random_access_iterator It>
+void AdaptiveRadixTree<Value, Pool, Key>::bulk_load(It first, It last, size_t threads) {
+    assert(std::is_sorted(first, last, [](const auto &a, const auto &b) {
+        return KeyTraits::bytes(key_of(a)) < KeyTraits::bytes(key_of(b));
+    }));
+    if (root->size() > 0 || root->leaf_) {
+        for (; first != last; ++first) {
+            const auto &[key, value] = *first;
+            insert(key, value);
+        }
+        return;
+    }
+    if (first == last) {
+        return;
+    }
+    Node *built = threads > 1 ? build_parallel(first, last, threads) : build(first, last, 0, true);
+    destroy_node(root);
+    root = built;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Node *
+AdaptiveRadixTree<Value, Pool, Key>::make_node(size_t childs, std::string_view prefix) {
+    if (childs <= Node4::SIZE) {
+        return create<Node4>(prefix);
+    }
+    if (childs <= Node16::SIZE) {
+        return create<Node16>(prefix);
+    }
+    if (childs <= Node48::SIZE) {
+        return create<Node48>(prefix);
+    }
+    return create<Node256>(prefix);
+}
+
+// keys of exactly length bytes end at the node, the last duplicate wins like insert
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename It>
+It AdaptiveRadixTree<Value, Pool, Key>::take_leaf(It first, It last, size_t length, Leaf *&leaf) {
+    for (; first != last && KeyTraits::bytes(key_of(*first)).length() == length; ++first) {
+        if (leaf) {
+            destroy<Leaf>(leaf);
+        }
+        const auto &[key, value] = *first;
+        auto encoded = KeyTraits::encode(key);
+        leaf = create<Leaf>(KeyTraits::bytes(encoded), value);
+    }
+    return first;
+}
+
+// end of the run of keys sharing the byte at depth with first
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename It>
+It AdaptiveRadixTree<Value, Pool, Key>::group_end(It first, It last, size_t depth) {
+    auto byte = static_cast<uint8_t>(KeyTraits::bytes(key_of(*first))[depth]);
+    return std::upper_bound(first, last, byte, [depth](uint8_t key, const auto &item) {
+        return key < static_cast<uint8_t>(KeyTraits::bytes(key_of(item))[depth]);
+    });
+}
+
+// Node for keys [first, last) that agree on their first depth bytes, its prefix runs from
+// depth to the longest common prefix of the first and last key.
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename It>
+AdaptiveRadixTree<Value, Pool, Key>::Node *
+AdaptiveRadixTree<Value, Pool, Key>::build(It first, It last, size_t depth, bool is_root) {
+    auto front_encoded = key_of(*first);
+    auto back_encoded = key_of(*(last - 1));
+    std::string_view front = KeyTraits::bytes(front_encoded);
+    std::string_view back = KeyTraits::bytes(back_encoded);
+    size_t end = depth;
+    if (!is_root) { // only root node prefix is empty
+        while (end < front.length() && end < back.length() && front[end] == back[end]) {
+            end += 1;
+        }
+    }
+
+    Leaf *leaf = nullptr;
+    first = take_leaf(first, last, end, leaf);
+    size_t childs = 0;
+    for (It it = first; it != last; it = group_end(it, last, end)) {
+        childs += 1;
+    }
+    Node *node = make_node(childs, front.substr(depth, end - depth));
+    node->leaf_ = leaf;
+    for (It it = first; it != last;) {
+        It group = group_end(it, last, end);
+        auto byte = static_cast<uint8_t>(KeyTraits::bytes(key_of(*it))[end]);
+        node->insert(byte, build(it, group, end, false));
+        it = group;
+    }
+    return node;
+}
+
+// Root for keys [first, last), each worker builds a contiguous run of first byte subtrees
+// into a private tree whose pools are spliced into ours afterwards.
+template <typename Value, template <typename> class Pool, typename Key>
+template <typename It>
+AdaptiveRadixTree<Value, Pool, Key>::Node *
+AdaptiveRadixTree<Value, Pool, Key>::build_parallel(It first, It last, size_t threads) {
+    struct Group {
+        It first;
+        It last;
+        Node *node;
+    };
+    Leaf *leaf = nullptr;
+    first = take_leaf(first, last, 0, leaf);
+    std::vector<Group> groups;
+    for (It it = first; it != last;) {
+        It group = group_end(it, last, 0);
+        groups.push_back({it, group, nullptr});
+        it = group;
+    }
+
+    std::vector<AdaptiveRadixTree> workers(threads);
+    std::vector<std::thread> runners;
+    auto total = static_cast<size_t>(last - first);
+    size_t begin = 0;
+    for (size_t t = 0; t < threads && begin < groups.size(); t++) {
+        size_t end = begin + 1; // balance by key count
+        while (end < groups.size() &&
+               static_cast<size_t>(groups[end].first - first) < total * (t + 1) / threads) {
+            end += 1;
+        }
+        runners.emplace_back([&worker = workers[t], &groups, begin, end] {
+            for (size_t i = begin; i < end; i++) {
+                groups[i].node = worker.build(groups[i].first, groups[i].last, 0, false);
+            }
+        });
+        begin = end;
+    }
+    for (auto &runner : runners) {
+        runner.join();
+    }
+
+    Node *node = make_node(groups.size(), "");
+    node->leaf_ = leaf;
+    for (auto &group : groups) {
+        node->insert(static_cast<uint8_t>(KeyTraits::bytes(key_of(*group.first))[0]), group.node);
+    }
+    for (auto &worker : workers) {
+        std::apply([&worker](auto &...pools) {
+            (pools.splice(std::get<std::remove_reference_t<decltype(pools)>>(worker.pools_)), ...);
+        }, pools_);
+        destroy_node(std::exchange(worker.root, nullptr)); // now lives in our pools
+    }
+    return node;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Stats AdaptiveRadixTree<Value, Pool, Key>::stats() const {
+    Stats stats;
+    size_t childs = 0;
+    collect_stats(root, 0, stats, childs);
+    size_t capacity = stats.nodes[0] * Node4::SIZE + stats.nodes[1] * Node16::SIZE +
+                      stats.nodes[2] * Node48::SIZE + stats.nodes[3] * Node256::SIZE;
+    if (stats.leaves > 0) {
+        stats.avg_depth /= static_cast<double>(stats.leaves);
+    }
+    stats.fill_factor = static_cast<double>(childs) / static_cast<double>(capacity);
+    return stats;
+}
+
+// avg_depth sums the depths, stats() divides
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::collect_stats(const Node *node, size_t depth,
+                                                        Stats &stats, size_t &childs) const {
+    static constexpr std::array<size_t, 4> Sizes = {sizeof(Node4), sizeof(Node16),
+                                                    sizeof(Node48), sizeof(Node256)};
+    auto type = static_cast<size_t>(node->type_);
+    stats.nodes[type] += 1;
+    stats.node_bytes += Sizes[type];
+    stats.prefix_bytes += heap_bytes(node->prefix_);
+    stats.prefix_lengths[std::min(node->prefix_.length(), Stats::PrefixBuckets - 1)] += 1;
+    if (const Leaf *leaf = node->leaf_; leaf) {
+        stats.leaves += 1;
+        stats.leaf_bytes += sizeof(Leaf);
+        if constexpr (std::is_same_v<typename KeyTraits::Stored, std::string>) {
+            stats.key_bytes += heap_bytes(leaf->key);
+        }
+        stats.max_depth = std::max(stats.max_depth, depth);
+        stats.avg_depth += static_cast<double>(depth);
+    }
+    childs += node->size_;
+    for (int slot = next_slot(node, NoSlot); slot != NoSlot; slot = next_slot(node, slot)) {
+        collect_stats(child_at(node, slot), depth + 1, stats, childs);
+    }
+}
+
+// heap memory behind a string, none while it fits the inline buffer
+template <typename Value, template <typename> class Pool, typename Key>
+size_t AdaptiveRadixTree<Value, Pool, Key>::heap_bytes(const std::string &str) noexcept {
+    const auto *object = reinterpret_cast<const char *>(&str);
+    bool inline_buffer = std::less_equal<>()(object, str.data()) &&
+                         std::less<>()(str.data(), object + sizeof(str));
+    return inline_buffer ? 0 : str.capacity() + 1;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+void AdaptiveRadixTree<Value, Pool, Key>::debug() {
     this->root->debug(0);
     std::cerr << "-----------------------------------\n";
 }
 
-template <typename Value> AdaptiveRadixTree<Value>::Iterator AdaptiveRadixTree<Value>::begin() {
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Iterator AdaptiveRadixTree<Value, Pool, Key>::begin() {
     return Iterator{root};
 }
 
-template <typename Value> AdaptiveRadixTree<Value>::Iterator AdaptiveRadixTree<Value>::end() {
-    return {};
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Iterator AdaptiveRadixTree<Value, Pool, Key>::end() {
+    Iterator it;
+    it.root_ = root;
+    return it;
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Iterator
+AdaptiveRadixTree<Value, Pool, Key>::lower_bound(KeyArg key) {
+    auto encoded = KeyTraits::encode(key);
+    return Iterator(root, KeyTraits::bytes(encoded), true);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Iterator
+AdaptiveRadixTree<Value, Pool, Key>::upper_bound(KeyArg key) {
+    auto encoded = KeyTraits::encode(key);
+    return Iterator(root, KeyTraits::bytes(encoded), false);
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Range AdaptiveRadixTree<Value, Pool, Key>::range(KeyArg from,
+                                                                                      KeyArg to) {
+    auto from_encoded = KeyTraits::encode(from);
+    auto to_encoded = KeyTraits::encode(to);
+    std::string_view from_bytes = KeyTraits::bytes(from_encoded);
+    std::string_view to_bytes = KeyTraits::bytes(to_encoded);
+    if (to_bytes <= from_bytes) {
+        return {end(), end()};
+    }
+    return {Iterator(root, from_bytes, true), Iterator(root, to_bytes, true)};
+}
+
+template <typename Value, template <typename> class Pool, typename Key>
+AdaptiveRadixTree<Value, Pool, Key>::Range
+AdaptiveRadixTree<Value, Pool, Key>::scan_prefix(std::string_view prefix) {
+    // the first key after the prefixed ones is the prefix with its last non 0xff byte bumped
+    std::string upper(prefix);
+    while (!upper.empty() && static_cast<uint8_t>(upper.back()) == 0xff) {
+        upper.pop_back();
+    }
+    if (upper.empty()) {
+        return {Iterator(root, prefix, true), end()};
+    }
+    upper.back() = static_cast<char>(static_cast<uint8_t>(upper.back()) + 1);
+    return {Iterator(root, prefix, true), Iterator(root, upper, true)};
 }
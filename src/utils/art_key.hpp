@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+// Binary comparable encodings for AdaptiveRadixTree keys: a < b exactly when encode(a) is
+// smaller than encode(b) comparing bytes as unsigned chars, so tree order is key order.
+//
+// A traits type provides
+//   Arg      the key type taken by the tree API
+//   Stored   the key kept in every leaf
+//   Encoded  encode()'s result, bytes() views it as the bytes the tree is keyed by
+//   decode() turning those bytes back into a Stored key
+// Fixed size encodings also set fixed_size and size. Their leaves keep the native key,
+// not a std::string copy of the bytes.
+template <typename Key> struct ArtKeyTraits;
+
+// byte strings are used as they are
+template <> struct ArtKeyTraits<std::string_view> {
+    using Arg = std::string_view;
+    using Stored = std::string;
+    using Encoded = std::string_view;
+    static constexpr bool fixed_size = false;
+
+    static Encoded encode(std::string_view key) noexcept { return key; }
+    static std::string_view bytes(const Encoded &encoded) noexcept { return encoded; }
+    static Stored decode(std::string_view bytes) { return Stored(bytes); }
+};
+
+template <> struct ArtKeyTraits<std::string> : ArtKeyTraits<std::string_view> {};
+
+// big-endian, the most significant byte decides first
+template <std::unsigned_integral T> struct ArtKeyTraits<T> {
+    using Arg = T;
+    using Stored = T;
+    using Encoded = std::array<char, sizeof(T)>;
+    static constexpr bool fixed_size = true;
+    static constexpr size_t size = sizeof(T);
+
+    static Encoded encode(T key) noexcept {
+        Encoded encoded;
+        for (size_t i = 0; i < size; i++) {
+            encoded[i] = static_cast<char>(key >> (8 * (size - 1 - i)));
+        }
+        return encoded;
+    }
+    static std::string_view bytes(const Encoded &encoded) noexcept {
+        return {encoded.data(), encoded.size()};
+    }
+    static T decode(std::string_view bytes) noexcept {
+        T key = 0;
+        for (size_t i = 0; i < size; i++) {
+            key = static_cast<T>((key << 8) | static_cast<uint8_t>(bytes[i]));
+        }
+        return key;
+    }
+};
+
+// flipping the sign bit moves negative numbers below the positive ones
+template <std::signed_integral T> struct ArtKeyTraits<T> {
+    using Unsigned = std::make_unsigned_t<T>;
+    using Base = ArtKeyTraits<Unsigned>;
+    using Arg = T;
+    using Stored = T;
+    using Encoded = typename Base::Encoded;
+    static constexpr bool fixed_size = true;
+    static constexpr size_t size = sizeof(T);
+    static constexpr Unsigned SignBit = Unsigned{1} << (8 * sizeof(T) - 1);
+
+    static Encoded encode(T key) noexcept {
+        return Base::encode(static_cast<Unsigned>(static_cast<Unsigned>(key) ^ SignBit));
+    }
+    static std::string_view bytes(const Encoded &encoded) noexcept { return Base::bytes(encoded); }
+    static T decode(std::string_view bytes) noexcept {
+        return static_cast<T>(static_cast<Unsigned>(Base::decode(bytes) ^ SignBit));
+    }
+};
+
+// IEEE 754: positive numbers get the sign bit set, negative ones have every bit inverted so
+// a larger magnitude sorts first. -0.0 sorts before 0.0, NaNs sort outside +-infinity.
+template <std::floating_point T>
+    requires(sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t))
+struct ArtKeyTraits<T> {
+    using Bits = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+    using Base = ArtKeyTraits<Bits>;
+    using Arg = T;
+    using Stored = T;
+    using Encoded = typename Base::Encoded;
+    static constexpr bool fixed_size = true;
+    static constexpr size_t size = sizeof(T);
+    static constexpr Bits SignBit = Bits{1} << (8 * sizeof(T) - 1);
+
+    static Encoded encode(T key) noexcept {
+        auto bits = std::bit_cast<Bits>(key);
+        return Base::encode((bits & SignBit) ? ~bits : bits | SignBit);
+    }
+    static std::string_view bytes(const Encoded &encoded) noexcept { return Base::bytes(encoded); }
+    static T decode(std::string_view bytes) noexcept {
+        Bits bits = Base::decode(bytes);
+        return std::bit_cast<T>((bits & SignBit) ? bits ^ SignBit : ~bits);
+    }
+};
+
+// Concatenated fields compare field by field. Only fixed size fields are allowed, a
+// variable length field would need escaping to keep the order.
+template <typename... Ts>
+    requires(ArtKeyTraits<Ts>::fixed_size && ...)
+struct ArtKeyTraits<std::tuple<Ts...>> {
+    using Arg = std::tuple<Ts...>;
+    using Stored = std::tuple<Ts...>;
+    static constexpr bool fixed_size = true;
+    static constexpr size_t size = (ArtKeyTraits<Ts>::size + ...);
+    using Encoded = std::array<char, size>;
+
+    static Encoded encode(const Arg &key) noexcept {
+        Encoded encoded;
+        size_t offset = 0;
+        std::apply(
+            [&](const auto &...fields) {
+                ((encode_field(encoded, offset, fields)), ...);
+            },
+            key);
+        return encoded;
+    }
+    static std::string_view bytes(const Encoded &encoded) noexcept {
+        return {encoded.data(), encoded.size()};
+    }
+    static Stored decode(std::string_view bytes) noexcept {
+        return decode_fields(bytes, std::index_sequence_for<Ts...>());
+    }
+
+  private:
+    template <typename T>
+    static void encode_field(Encoded &encoded, size_t &offset, const T &field) noexcept {
+        auto bytes = ArtKeyTraits<T>::encode(field);
+        std::memcpy(encoded.data() + offset, bytes.data(), bytes.size());
+        offset += bytes.size();
+    }
+
+    template <size_t... I>
+    static Stored decode_fields(std::string_view bytes, std::index_sequence<I...>) noexcept {
+        constexpr std::array<size_t, sizeof...(Ts)> sizes{ArtKeyTraits<Ts>::size...};
+        std::array<size_t, sizeof...(Ts)> offsets{};
+        for (size_t i = 1; i < sizes.size(); i++) {
+            offsets[i] = offsets[i - 1] + sizes[i - 1];
+        }
+        return Stored(ArtKeyTraits<Ts>::decode(bytes.substr(offsets[I], sizes[I]))...);
+    }
+};
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/inline_stack.hpp"
+#include "utils/system_call.hpp"
+
+// Read-only AdaptiveRadixTree image that is used straight from a mmap()ed file.
+//
+// write() serialises a tree, open the file with the ArtSnapshot constructor to search and
+// iterate it without deserialising. Records refer to each other by file offset, so the
+// mapping works at any address and processes mapping the same file share its pages.
+//
+// Layout, every record starts 8 byte aligned, children are written before their parent:
+//   Header
+//   Leaf  { Value value; uint32_t key_length; char key[key_length] }
+//   Node  { uint32_t prefix_length; uint16_t childs; uint8_t dense; uint8_t pad;
+//           uint64_t leaf; char prefix[prefix_length];
+//           sparse: uint8_t keys[childs] sorted, uint64_t offsets[childs]
+//           dense:  uint64_t offsets[256], 0 for a missing child }
+// Offset 0 is the header, so 0 also means no leaf or no child. Values are stored as raw
+// bytes in host byte order. Every record is bounds checked before it is read and children
+// must lie before their parent, a damaged file throws std::runtime_error instead of reading
+// outside the mapping or looping.
+template <typename Value> class ArtSnapshot {
+    static_assert(std::is_trivially_copyable_v<Value>, "snapshot values are raw bytes");
+    static_assert(alignof(Value) <= 8);
+
+    static constexpr char Magic[8] = {'C', 'O', 'A', 'R', 'T', 'S', 'N', 'P'};
+    static constexpr uint32_t Version = 1;
+    static constexpr size_t DenseChilds = 48; // more children use a 256 entry table
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t value_size;
+        uint64_t count;
+        uint64_t root;
+        uint64_t file_size;
+    };
+
+    struct NodeHeader {
+        uint32_t prefix_length;
+        uint16_t childs;
+        uint8_t dense;
+        uint8_t pad;
+        uint64_t leaf;
+    };
+
+    // a node record decoded in place
+    struct NodeView {
+        uint64_t offset; // of the record
+        NodeHeader header;
+        std::string_view prefix;
+        const uint8_t *keys; // sparse only
+        const char *offsets;
+
+        [[nodiscard]] uint64_t child(int slot) const {
+            uint64_t child = 0;
+            std::memcpy(&child, offsets + static_cast<size_t>(slot) * sizeof(child),
+                        sizeof(child));
+            if (child >= offset) { // children are written first, this also rules out cycles
+                corrupt();
+            }
+            return child;
+        }
+
+        [[nodiscard]] int next_slot(int slot) const {
+            if (!header.dense) {
+                return slot + 1 < header.childs ? slot + 1 : -1;
+            }
+            for (slot += 1; slot < 256; slot++) {
+                if (child(slot) != 0) {
+                    return slot;
+                }
+            }
+            return -1;
+        }
+
+        [[nodiscard]] uint64_t find(uint8_t key) const {
+            if (header.dense) {
+                return child(key);
+            }
+            const uint8_t *end = keys + header.childs;
+            const uint8_t *it = std::lower_bound(keys, end, key);
+            return it != end && *it == key ? child(static_cast<int>(it - keys)) : 0;
+        }
+    };
+
+  public:
+    struct Entry {
+        std::string_view key;
+        Value value;
+    };
+
+    class Iterator {
+        friend class ArtSnapshot;
+
+        struct Frame {
+            uint64_t node;
+            int slot;
+        };
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Entry;
+        using pointer = void;
+        using reference = Entry;
+
+        Iterator() = default;
+
+        Entry operator*() const {
+            return snapshot_->leaf(snapshot_->node(stack_.top().node).header.leaf);
+        }
+
+        bool operator==(const Iterator &other) const {
+            if (stack_.size() != other.stack_.size()) {
+                return false;
+            }
+            return stack_.empty() || stack_.top().node == other.stack_.top().node;
+        }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+        Iterator &operator++() {
+            while (!stack_.empty()) {
+                Frame &top = stack_.top();
+                NodeView view = snapshot_->node(top.node);
+                if (int slot = view.next_slot(top.slot); slot >= 0) {
+                    top.slot = slot;
+                    stack_.push(Frame{view.child(slot), -1});
+                    if (snapshot_->node(stack_.top().node).header.leaf != 0) {
+                        return *this;
+                    }
+                } else {
+                    stack_.pop();
+                }
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+      private:
+        explicit Iterator(const ArtSnapshot *snapshot) : snapshot_(snapshot) {
+            stack_.push(Frame{snapshot->header().root, -1});
+            if (snapshot->node(snapshot->header().root).header.leaf == 0) {
+                ++(*this);
+            }
+        }
+
+        const ArtSnapshot *snapshot_ = nullptr;
+        InlineStack<Frame, 32> stack_;
+    };
+
+    explicit ArtSnapshot(const std::string &path) {
+        File fd(co_io::system_call(::open(path.c_str(), O_RDONLY | O_CLOEXEC)).execption("open"));
+        struct stat st {};
+        co_io::system_call(::fstat(fd.fd(), &st)).execption("fstat");
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ < sizeof(Header)) {
+            throw std::runtime_error("art snapshot: truncated file");
+        }
+        void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd.fd(), 0);
+        if (data == MAP_FAILED) {
+            co_io::system_call(-1).execption("mmap");
+        }
+        data_ = static_cast<const char *>(data);
+        Header head = header();
+        if (std::memcmp(head.magic, Magic, sizeof(Magic)) != 0 || head.version != Version ||
+            head.value_size != sizeof(Value) || head.file_size != size_) {
+            ::munmap(data, size_);
+            throw std::runtime_error("art snapshot: bad header");
+        }
+        try {
+            (void)node(head.root);
+        } catch (const std::runtime_error &) {
+            ::munmap(data, size_);
+            throw;
+        }
+    }
+
+    ArtSnapshot(const ArtSnapshot &) = delete;
+    ArtSnapshot &operator=(const ArtSnapshot &) = delete;
+    ArtSnapshot(ArtSnapshot &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    ArtSnapshot &operator=(ArtSnapshot &&other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    ~ArtSnapshot() {
+        if (data_) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return header().count; }
+
+    std::optional<Value> search(std::string_view key) const {
+        NodeView current = node(header().root);
+        while (!key.empty()) {
+            if (!key.starts_with(current.prefix)) { // prefix not complete match
+                return std::nullopt;
+            }
+            key.remove_prefix(current.prefix.length());
+            if (key.empty()) {
+                break;
+            }
+            uint64_t next = current.find(static_cast<uint8_t>(key[0]));
+            if (next == 0) {
+                return std::nullopt;
+            }
+            current = node(next);
+        }
+        if (current.header.leaf == 0) {
+            return std::nullopt;
+        }
+        return leaf(current.header.leaf).value;
+    }
+
+    Iterator begin() const { return size() > 0 ? Iterator(this) : end(); }
+    Iterator end() const {
+        Iterator it;
+        it.snapshot_ = this;
+        return it;
+    }
+
+    // Serialises tree to path. The file is written next to path and renamed over it, so
+    // processes that have the old snapshot mapped keep a consistent image.
+    template <template <typename> class Pool>
+    static void write(AdaptiveRadixTree<Value, Pool> &tree, const std::string &path) {
+        std::vector<std::pair<std::string_view, Value>> sorted;
+        for (const auto &leaf : tree) {
+            sorted.emplace_back(leaf.key, leaf.value);
+        }
+
+        std::string out(sizeof(Header), '\0');
+        Header head{};
+        std::memcpy(head.magic, Magic, sizeof(Magic));
+        head.version = Version;
+        head.value_size = sizeof(Value);
+        head.count = sorted.size();
+        head.root = emit(out, sorted.begin(), sorted.end(), 0, true);
+        head.file_size = out.size();
+        std::memcpy(out.data(), &head, sizeof(head));
+
+        std::string tmp = path + ".tmp";
+        {
+            File fd(co_io::system_call(
+                        ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+                        .execption("open"));
+            for (size_t written = 0; written < out.size();) {
+                written += static_cast<size_t>(
+                    co_io::system_call(
+                        ::write(fd.fd(), out.data() + written, out.size() - written))
+                        .execption("write"));
+            }
+            co_io::system_call(::fsync(fd.fd())).execption("fsync");
+        }
+        co_io::system_call(::rename(tmp.c_str(), path.c_str())).execption("rename");
+    }
+
+  private:
+    struct File {
+        int fd_;
+
+        explicit File(int fd) : fd_(fd) {}
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+        ~File() { ::close(fd_); }
+
+        [[nodiscard]] int fd() const noexcept { return fd_; }
+    };
+
+    [[nodiscard]] Header header() const noexcept {
+        Header head;
+        std::memcpy(&head, data_, sizeof(head));
+        return head;
+    }
+
+    [[noreturn]] static void corrupt() { throw std::runtime_error("art snapshot: corrupt record"); }
+
+    // the length bytes at offset, which must lie after the header and inside the file
+    [[nodiscard]] const char *bytes(uint64_t offset, size_t length) const {
+        if (offset < sizeof(Header) || offset % 8 != 0 || offset > size_ ||
+            length > size_ - offset) {
+            corrupt();
+        }
+        return data_ + offset;
+    }
+
+    [[nodiscard]] NodeView node(uint64_t offset) const {
+        NodeView view{};
+        view.offset = offset;
+        std::memcpy(&view.header, bytes(offset, sizeof(NodeHeader)), sizeof(view.header));
+        size_t length = sizeof(NodeHeader) + align(view.header.prefix_length) +
+                        (view.header.dense ? 256 * sizeof(uint64_t)
+                                           : align(view.header.childs) +
+                                                 view.header.childs * sizeof(uint64_t));
+        const char *record = bytes(offset, length) + sizeof(NodeHeader);
+        view.prefix = std::string_view(record, view.header.prefix_length);
+        record += align(view.header.prefix_length);
+        if (!view.header.dense) {
+            view.keys = reinterpret_cast<const uint8_t *>(record);
+            record += align(view.header.childs);
+        }
+        view.offsets = record;
+        return view;
+    }
+
+    [[nodiscard]] Entry leaf(uint64_t offset) const {
+        Entry entry{};
+        const char *record = bytes(offset, sizeof(Value) + sizeof(uint32_t));
+        std::memcpy(&entry.value, record, sizeof(Value));
+        uint32_t key_length = 0;
+        std::memcpy(&key_length, record + sizeof(Value), sizeof(key_length));
+        (void)bytes(offset, sizeof(Value) + sizeof(key_length) + key_length);
+        entry.key = std::string_view(record + sizeof(Value) + sizeof(key_length), key_length);
+        return entry;
+    }
+
+    static constexpr size_t align(size_t n) noexcept { return (n + 7) & ~size_t{7}; }
+
+    static void pad(std::string &out) { out.resize(align(out.size()), '\0'); }
+
+    template <typename T> static void append(std::string &out, const T &value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    // Same grouping as AdaptiveRadixTree::bulk_load, keys [first, last) agree on their first
+    // depth bytes and the node prefix runs to their longest common prefix.
+    template <typename It>
+    static uint64_t emit(std::string &out, It first, It last, size_t depth, bool is_root) {
+        std::string_view front = first == last ? std::string_view() : first->first;
+        std::string_view back = first == last ? std::string_view() : (last - 1)->first;
+        size_t end = depth;
+        if (!is_root) { // only root node prefix is empty
+            while (end < front.length() && end < back.length() && front[end] == back[end]) {
+                end += 1;
+            }
+        }
+
+        uint64_t leaf = 0;
+        if (first != last && first->first.length() == end) { // keys are unique
+            pad(out);
+            leaf = out.size();
+            append(out, first->second);
+            append(out, static_cast<uint32_t>(first->first.length()));
+            out.append(first->first);
+            ++first;
+        }
+
+        std::vector<std::pair<uint8_t, uint64_t>> childs;
+        for (It it = first; it != last;) {
+            auto byte = static_cast<uint8_t>(it->first[end]);
+            It group = std::find_if(it, last, [end, byte](const auto &item) {
+                return static_cast<uint8_t>(item.first[end]) != byte;
+            });
+            childs.emplace_back(byte, emit(out, it, group, end, false));
+            it = group;
+        }
+
+        pad(out);
+        uint64_t offset = out.size();
+        NodeHeader head{};
+        head.prefix_length = static_cast<uint32_t>(end - depth);
+        head.childs = static_cast<uint16_t>(childs.size());
+        head.dense = childs.size() > DenseChilds;
+        head.leaf = leaf;
+        append(out, head);
+        out.append(front.substr(depth, end - depth));
+        pad(out);
+        if (head.dense) {
+            std::vector<uint64_t> table(256, 0);
+            for (auto [key, child] : childs) {
+                table[key] = child;
+            }
+            for (uint64_t child : table) {
+                append(out, child);
+            }
+        } else {
+            for (auto [key, child] : childs) {
+                append(out, key);
+            }
+            pad(out);
+            for (auto [key, child] : childs) {
+                append(out, child);
+            }
+        }
+        return offset;
+    }
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <utility>
+
+namespace co_io {
+
+// Fixed size block of a ChainBuffer, bytes [read, write) are readable.
+struct BufferSegment {
+    static constexpr size_t Size = 16 * 1024;
+
+    BufferSegment *next = nullptr;
+    size_t read = 0;
+    size_t write = 0;
+    char data[Size];
+
+    [[nodiscard]] size_t readable() const noexcept { return write - read; }
+    [[nodiscard]] size_t writable() const noexcept { return Size - write; }
+};
+
+// Free list of segments, one per loop. Buffers take segments when they fill up and give
+// them back as soon as they drain, so idle buffers hold no memory.
+class SegmentPool {
+  public:
+    explicit SegmentPool(size_t max_cached = 256) : max_cached_(max_cached) {}
+    SegmentPool(const SegmentPool &) = delete;
+    SegmentPool &operator=(const SegmentPool &) = delete;
+    ~SegmentPool() {
+        while (free_) {
+            delete std::exchange(free_, free_->next);
+        }
+    }
+
+    BufferSegment *acquire() {
+        BufferSegment *segment = free_;
+        if (segment) {
+            free_ = segment->next;
+            cached_ -= 1;
+        } else {
+            segment = new BufferSegment;
+        }
+        segment->next = nullptr;
+        segment->read = 0;
+        segment->write = 0;
+        return segment;
+    }
+
+    void release(BufferSegment *segment) noexcept {
+        if (cached_ >= max_cached_) {
+            delete segment;
+            return;
+        }
+        segment->next = free_;
+        free_ = segment;
+        cached_ += 1;
+    }
+
+    [[nodiscard]] size_t cached() const noexcept { return cached_; }
+
+  private:
+    BufferSegment *free_ = nullptr;
+    size_t cached_ = 0;
+    size_t max_cached_; // idle segments kept, the rest is freed
+};
+
+// Byte queue over a chain of pooled segments with separate reader and writer cursors.
+// Writers append() or fill the space from prepare() and commit() it, readers look at
+// front() or readable() and consume() what they used. Growing adds a segment instead of
+// reallocating, so bytes never move except when compact() packs a single segment.
+class ChainBuffer {
+  public:
+    explicit ChainBuffer(SegmentPool &pool) : pool_(&pool) {}
+    ChainBuffer(const ChainBuffer &) = delete;
+    ChainBuffer &operator=(const ChainBuffer &) = delete;
+    ChainBuffer(ChainBuffer &&other) noexcept
+        : pool_(other.pool_), head_(std::exchange(other.head_, nullptr)),
+          tail_(std::exchange(other.tail_, nullptr)),
+          writer_(std::exchange(other.writer_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    ChainBuffer &operator=(ChainBuffer &&other) noexcept {
+        std::swap(pool_, other.pool_);
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(writer_, other.writer_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    ~ChainBuffer() { clear(); }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; } // readable bytes
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    // readable bytes of the first segment
+    [[nodiscard]] std::string_view front() const noexcept {
+        return head_ ? std::string_view(head_->data + head_->read, head_->readable())
+                     : std::string_view();
+    }
+
+    // Drops n readable bytes, drained segments go back to the pool.
+    void consume(size_t n) noexcept {
+        assert(n <= size_);
+        size_ -= n;
+        if (size_ == 0) {
+            clear();
+            return;
+        }
+        while (n > 0) {
+            size_t step = std::min(n, head_->readable());
+            head_->read += step;
+            n -= step;
+            if (head_->readable() == 0) { // never the writer segment, it still has data
+                pool_->release(std::exchange(head_, head_->next));
+            }
+        }
+    }
+
+    void append(std::string_view data) {
+        while (!data.empty()) {
+            BufferSegment *segment = writable_segment();
+            size_t step = std::min(data.size(), segment->writable());
+            std::memcpy(segment->data + segment->write, data.data(), step);
+            segment->write += step;
+            size_ += step;
+            data.remove_prefix(step);
+        }
+    }
+
+    template <size_t N> void append(const char (&str)[N]) { append(std::string_view{str, N - 1}); }
+
+    // Writable space of at least size bytes as iovecs, fewer when iov runs out. Returns the
+    // number of iovecs used, commit() makes the bytes written there readable.
+    size_t prepare(size_t size, std::span<iovec> iov) {
+        compact();
+        size_t count = 0;
+        size_t available = 0;
+        BufferSegment *segment = nullptr;
+        while (count < iov.size() && available < size) {
+            // only take a segment that goes into an iovec
+            segment = segment == nullptr ? writable_segment()
+                      : segment->next    ? segment->next
+                                         : push_segment();
+            iov[count++] = {segment->data + segment->write, segment->writable()};
+            available += segment->writable();
+        }
+        return count;
+    }
+
+    void commit(size_t n) noexcept {
+        size_ += n;
+        while (n > 0) {
+            size_t step = std::min(n, writer_->writable());
+            writer_->write += step;
+            n -= step;
+            if (writer_->writable() == 0 && writer_->next) {
+                writer_ = writer_->next;
+            }
+        }
+    }
+
+    // Readable bytes as iovecs for writev, returns the number used.
+    size_t readable(std::span<iovec> iov) const noexcept {
+        size_t count = 0;
+        for (BufferSegment *segment = head_; segment && count < iov.size();
+             segment = segment->next) {
+            if (segment->readable() == 0) {
+                break;
+            }
+            iov[count++] = {segment->data + segment->read, segment->readable()};
+        }
+        return count;
+    }
+
+    // Moves the readable bytes of a lone segment to its start, so the free space is one
+    // contiguous block again.
+    void compact() noexcept {
+        if (head_ && head_ == writer_ && head_->read > 0) {
+            std::memmove(head_->data, head_->data + head_->read, head_->readable());
+            head_->write -= head_->read;
+            head_->read = 0;
+        }
+    }
+
+    void clear() noexcept {
+        while (head_) {
+            pool_->release(std::exchange(head_, head_->next));
+        }
+        tail_ = nullptr;
+        writer_ = nullptr;
+        size_ = 0;
+    }
+
+    // copy of the readable bytes
+    [[nodiscard]] std::string str() const {
+        std::string result;
+        result.reserve(size_);
+        for (BufferSegment *segment = head_; segment; segment = segment->next) {
+            result.append(segment->data + segment->read, segment->readable());
+        }
+        return result;
+    }
+
+  private:
+    BufferSegment *push_segment() {
+        BufferSegment *segment = pool_->acquire();
+        if (tail_) {
+            tail_->next = segment;
+        } else {
+            head_ = segment;
+        }
+        tail_ = segment;
+        if (writer_ == nullptr) {
+            writer_ = segment;
+        }
+        return segment;
+    }
+
+    // segment the next written byte goes to
+    BufferSegment *writable_segment() {
+        if (writer_ == nullptr) {
+            return push_segment();
+        }
+        if (writer_->writable() == 0) {
+            writer_ = writer_->next ? writer_->next : push_segment();
+        }
+        return writer_;
+    }
+
+    SegmentPool *pool_;
+    BufferSegment *head_ = nullptr;
+    BufferSegment *tail_ = nullptr;
+    BufferSegment *writer_ = nullptr; // segments after it are empty
+    size_t size_ = 0;
+};
+
+} // namespace co_io
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "utils/epoch.hpp"
+
+// AdaptiveRadixTree for concurrent readers and writers, synchronized with optimistic lock
+// coupling (Leis et al., The ART of Practical Synchronization).
+//
+// Every node carries a version word. Readers never write shared memory, they remember the
+// version, read the node and validate the version afterwards, going back to the root when a
+// writer got in between. Writers lock only the one or two nodes they modify. Replaced nodes
+// and leaves are freed through EpochManager once no reader can still hold them.
+//
+// Leaves and node prefixes are immutable: insert on an existing key swaps in a new leaf and a
+// prefix split copies the node under a new Node4. Nodes do not shrink on remove.
+template <typename Value> class ConcurrentAdaptiveRadixTree {
+    struct Node;
+    template <size_t Capacity> struct SmallNode;
+    struct Node48;
+    struct Node256;
+    using Node4 = SmallNode<4>;
+    using Node16 = SmallNode<16>;
+    enum class NodeType : uint8_t { N4, N16, N48, N256 };
+
+  public:
+    struct Leaf;
+
+    ConcurrentAdaptiveRadixTree() : root(new Node256("")) {}
+    ConcurrentAdaptiveRadixTree(const ConcurrentAdaptiveRadixTree &) = delete;
+    ConcurrentAdaptiveRadixTree &operator=(const ConcurrentAdaptiveRadixTree &) = delete;
+
+    // no operation may be running on other threads
+    ~ConcurrentAdaptiveRadixTree() { destroy_tree(root); }
+
+    void insert(std::string_view key, Value value);
+    std::optional<Value> search(std::string_view key) const;
+    bool remove(std::string_view key);
+
+  private:
+    // The try_ functions make one optimistic pass from the root, false means a conflict
+    // was detected and the operation has to start over.
+    bool try_insert(std::string_view key, Value &value);
+    bool try_search(std::string_view key, std::optional<Value> &result) const;
+    bool try_remove(std::string_view key, bool &removed);
+
+    template <typename F> static decltype(auto) visit(Node *node, F &&f);
+    static Node *make_node(NodeType type, std::string_view prefix);
+    static Node *make_leaf_node(std::string_view prefix, std::string_view key, Value &value);
+    static Node *find_child(Node *node, uint8_t key) noexcept;
+    static void insert_child(Node *node, uint8_t key, Node *child) noexcept;
+    static void replace_child(Node *node, uint8_t key, Node *child) noexcept;
+    static void remove_child(Node *node, uint8_t key) noexcept;
+    static bool is_full(Node *node) noexcept;
+    static Node *copy(Node *node, std::string_view prefix, bool grow);
+
+    static void delete_node(void *node) noexcept;
+    static void delete_leaf(void *leaf) noexcept;
+    static void destroy_tree(Node *node) noexcept;
+
+    Node *const root;
+};
+
+template <typename Value> struct ConcurrentAdaptiveRadixTree<Value>::Leaf {
+    const std::string key;
+    const Value value;
+
+    Leaf(std::string_view key, Value val) : key(key), value(std::move(val)) {}
+};
+
+template <typename Value> struct ConcurrentAdaptiveRadixTree<Value>::Node {
+    // version word: bit 0 obsolete, bit 1 locked, the rest counts writes
+    static constexpr uint64_t Obsolete = 0b01;
+    static constexpr uint64_t Locked = 0b10;
+
+    std::atomic<uint64_t> version_{0};
+    std::atomic<uint16_t> size_{0};
+    const NodeType type_;
+    const std::string prefix_;
+    std::atomic<Leaf *> leaf_{nullptr};
+
+    Node(std::string_view prefix, NodeType type) : type_(type), prefix_(prefix) {}
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    [[nodiscard]] size_t match(std::string_view match_prefix) const {
+        size_t i = 0;
+        for (i = 0; i < match_prefix.size() && i < prefix_.size(); i++) {
+            if (prefix_[i] != match_prefix[i]) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    // Waits out a writer, false when the node has been replaced.
+    bool read_lock(uint64_t &version) const noexcept {
+        version = version_.load(std::memory_order_acquire);
+        while (version & Locked) {
+            std::this_thread::yield();
+            version = version_.load(std::memory_order_acquire);
+        }
+        return !(version & Obsolete);
+    }
+
+    // Everything read since read_lock belongs to one consistent version of the node.
+    [[nodiscard]] bool validate(uint64_t version) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
+    // Turns a validated read into a write lock, fails if a writer got in since.
+    bool upgrade(uint64_t version) noexcept {
+        if (!version_.compare_exchange_strong(version, version + Locked,
+                                              std::memory_order_acquire)) {
+            return false;
+        }
+        // readers seeing any of our writes must also see the lock
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    void write_unlock() noexcept { version_.fetch_add(Locked, std::memory_order_release); }
+    void write_unlock_obsolete() noexcept {
+        version_.fetch_add(Locked | Obsolete, std::memory_order_release);
+    }
+};
+
+// Node4 and Node16, children are kept unsorted in insertion order
+template <typename Value>
+template <size_t Capacity>
+struct ConcurrentAdaptiveRadixTree<Value>::SmallNode : public Node {
+    static constexpr size_t SIZE = Capacity;
+    std::array<std::atomic<uint8_t>, SIZE> keys_{};
+    std::array<std::atomic<Node *>, SIZE> childs_{};
+
+    explicit SmallNode(std::string_view prefix)
+        : Node(prefix, SIZE == 4 ? NodeType::N4 : NodeType::N16) {}
+
+    [[nodiscard]] size_t size() const noexcept {
+        return std::min<size_t>(Node::size_.load(std::memory_order_relaxed), SIZE);
+    }
+
+    Node *find(uint8_t key) const noexcept {
+        for (size_t i = 0; i < size(); i++) {
+            if (keys_[i].load(std::memory_order_relaxed) == key) {
+                return childs_[i].load(std::memory_order_acquire);
+            }
+        }
+        return nullptr;
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        size_t index = size();
+        keys_[index].store(key, std::memory_order_relaxed);
+        childs_[index].store(child, std::memory_order_release);
+        Node::size_.store(static_cast<uint16_t>(index + 1), std::memory_order_release);
+    }
+
+    void replace(uint8_t key, Node *child) noexcept {
+        for (size_t i = 0; i < size(); i++) {
+            if (keys_[i].load(std::memory_order_relaxed) == key) {
+                childs_[i].store(child, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    void remove(uint8_t key) noexcept {
+        size_t last = size() - 1;
+        for (size_t i = 0; i <= last; i++) {
+            if (keys_[i].load(std::memory_order_relaxed) == key) { // move the last child here
+                keys_[i].store(keys_[last].load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+                childs_[i].store(childs_[last].load(std::memory_order_relaxed),
+                                 std::memory_order_release);
+                Node::size_.store(static_cast<uint16_t>(last), std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t i = 0; i < size(); i++) {
+            f(keys_[i].load(std::memory_order_relaxed), childs_[i].load(std::memory_order_acquire));
+        }
+    }
+};
+
+template <typename Value> struct ConcurrentAdaptiveRadixTree<Value>::Node48 : public Node {
+    static constexpr size_t SIZE = 48;
+    static constexpr uint8_t Empty = SIZE;
+    std::array<std::atomic<uint8_t>, 256> index_{};
+    std::array<std::atomic<Node *>, SIZE> childs_{};
+
+    explicit Node48(std::string_view prefix) : Node(prefix, NodeType::N48) {
+        for (auto &index : index_) {
+            index.store(Empty, std::memory_order_relaxed);
+        }
+    }
+
+    Node *find(uint8_t key) const noexcept {
+        uint8_t index = index_[key].load(std::memory_order_acquire);
+        return index == Empty ? nullptr : childs_[index].load(std::memory_order_acquire);
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        uint8_t slot = 0;
+        while (childs_[slot].load(std::memory_order_relaxed) != nullptr) {
+            slot += 1;
+        }
+        childs_[slot].store(child, std::memory_order_release);
+        index_[key].store(slot, std::memory_order_release);
+        Node::size_.fetch_add(1, std::memory_order_release);
+    }
+
+    void replace(uint8_t key, Node *child) noexcept {
+        childs_[index_[key].load(std::memory_order_relaxed)].store(child,
+                                                                   std::memory_order_release);
+    }
+
+    void remove(uint8_t key) noexcept {
+        uint8_t index = index_[key].load(std::memory_order_relaxed);
+        index_[key].store(Empty, std::memory_order_release);
+        childs_[index].store(nullptr, std::memory_order_release);
+        Node::size_.fetch_sub(1, std::memory_order_release);
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t key = 0; key < index_.size(); key++) {
+            if (uint8_t index = index_[key].load(std::memory_order_relaxed); index != Empty) {
+                f(static_cast<uint8_t>(key), childs_[index].load(std::memory_order_acquire));
+            }
+        }
+    }
+};
+
+template <typename Value> struct ConcurrentAdaptiveRadixTree<Value>::Node256 : public Node {
+    static constexpr size_t SIZE = 256;
+    std::array<std::atomic<Node *>, SIZE> childs_{};
+
+    explicit Node256(std::string_view prefix) : Node(prefix, NodeType::N256) {}
+
+    Node *find(uint8_t key) const noexcept {
+        return childs_[key].load(std::memory_order_acquire);
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        childs_[key].store(child, std::memory_order_release);
+        Node::size_.fetch_add(1, std::memory_order_release);
+    }
+
+    void replace(uint8_t key, Node *child) noexcept {
+        childs_[key].store(child, std::memory_order_release);
+    }
+
+    void remove(uint8_t key) noexcept {
+        childs_[key].store(nullptr, std::memory_order_release);
+        Node::size_.fetch_sub(1, std::memory_order_release);
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t key = 0; key < SIZE; key++) {
+            if (Node *child = childs_[key].load(std::memory_order_acquire); child) {
+                f(static_cast<uint8_t>(key), child);
+            }
+        }
+    }
+};
+
+template <typename Value>
+template <typename F>
+decltype(auto) ConcurrentAdaptiveRadixTree<Value>::visit(Node *node, F &&f) {
+    switch (node->type_) {
+    case NodeType::N4:
+        return f(static_cast<Node4 *>(node));
+    case NodeType::N16:
+        return f(static_cast<Node16 *>(node));
+    case NodeType::N48:
+        return f(static_cast<Node48 *>(node));
+    case NodeType::N256:
+        break;
+    }
+    return f(static_cast<Node256 *>(node));
+}
+
+template <typename Value>
+ConcurrentAdaptiveRadixTree<Value>::Node *
+ConcurrentAdaptiveRadixTree<Value>::make_node(NodeType type, std::string_view prefix) {
+    switch (type) {
+    case NodeType::N4:
+        return new Node4(prefix);
+    case NodeType::N16:
+        return new Node16(prefix);
+    case NodeType::N48:
+        return new Node48(prefix);
+    case NodeType::N256:
+        break;
+    }
+    return new Node256(prefix);
+}
+
+template <typename Value>
+ConcurrentAdaptiveRadixTree<Value>::Node *
+ConcurrentAdaptiveRadixTree<Value>::make_leaf_node(std::string_view prefix, std::string_view key,
+                                                   Value &value) {
+    Node *node = new Node4(prefix);
+    node->leaf_.store(new Leaf(key, std::move(value)), std::memory_order_relaxed);
+    return node;
+}
+
+template <typename Value>
+ConcurrentAdaptiveRadixTree<Value>::Node *
+ConcurrentAdaptiveRadixTree<Value>::find_child(Node *node, uint8_t key) noexcept {
+    return visit(node, [key](auto *n) { return n->find(key); });
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::insert_child(Node *node, uint8_t key,
+                                                      Node *child) noexcept {
+    visit(node, [key, child](auto *n) { n->insert(key, child); });
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::replace_child(Node *node, uint8_t key,
+                                                       Node *child) noexcept {
+    visit(node, [key, child](auto *n) { n->replace(key, child); });
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::remove_child(Node *node, uint8_t key) noexcept {
+    visit(node, [key](auto *n) { n->remove(key); });
+}
+
+template <typename Value> bool ConcurrentAdaptiveRadixTree<Value>::is_full(Node *node) noexcept {
+    return visit(node, [](auto *n) {
+        return n->size_.load(std::memory_order_relaxed) >= std::decay_t<decltype(*n)>::SIZE;
+    });
+}
+
+// Copy of a locked node with a new prefix, one size up when grow is set.
+template <typename Value>
+ConcurrentAdaptiveRadixTree<Value>::Node *
+ConcurrentAdaptiveRadixTree<Value>::copy(Node *node, std::string_view prefix, bool grow) {
+    auto type = static_cast<uint8_t>(node->type_);
+    Node *result = make_node(static_cast<NodeType>(grow ? type + 1 : type), prefix);
+    result->leaf_.store(node->leaf_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    visit(node, [result](auto *n) {
+        n->for_each([result](uint8_t key, Node *child) { insert_child(result, key, child); });
+    });
+    return result;
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::delete_node(void *node) noexcept {
+    visit(static_cast<Node *>(node), [](auto *n) { delete n; });
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::delete_leaf(void *leaf) noexcept {
+    delete static_cast<Leaf *>(leaf);
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::destroy_tree(Node *node) noexcept {
+    visit(node, [](auto *n) { n->for_each([](uint8_t, Node *child) { destroy_tree(child); }); });
+    delete node->leaf_.load(std::memory_order_relaxed);
+    delete_node(node);
+}
+
+template <typename Value>
+void ConcurrentAdaptiveRadixTree<Value>::insert(std::string_view key, Value value) {
+    EpochGuard guard;
+    while (!try_insert(key, value)) {
+    }
+}
+
+template <typename Value>
+std::optional<Value> ConcurrentAdaptiveRadixTree<Value>::search(std::string_view key) const {
+    EpochGuard guard;
+    std::optional<Value> result;
+    while (!try_search(key, result)) {
+    }
+    return result;
+}
+
+template <typename Value> bool ConcurrentAdaptiveRadixTree<Value>::remove(std::string_view key) {
+    EpochGuard guard;
+    bool removed = false;
+    while (!try_remove(key, removed)) {
+    }
+    return removed;
+}
+
+template <typename Value>
+bool ConcurrentAdaptiveRadixTree<Value>::try_insert(std::string_view key, Value &value) {
+    Node *parent = nullptr;
+    uint64_t parent_version = 0;
+    uint8_t parent_key = 0;
+    Node *node = root;
+    uint64_t version = 0;
+    if (!node->read_lock(version)) {
+        return false;
+    }
+
+    size_t depth = 0;
+    while (true) {
+        std::string_view remain = key.substr(depth);
+        size_t match_prefix = node->match(remain);
+        if (node->prefix_.length() > match_prefix) { // split, never happens at the root
+            if (!parent->upgrade(parent_version)) {
+                return false;
+            }
+            if (!node->upgrade(version)) {
+                parent->write_unlock();
+                return false;
+            }
+            Node *split = new Node4(remain.substr(0, match_prefix));
+            Node *moved = copy(node, std::string_view(node->prefix_).substr(match_prefix), false);
+            insert_child(split, static_cast<uint8_t>(moved->prefix_[0]), moved);
+            if (remain.length() == match_prefix) {
+                split->leaf_.store(new Leaf(key, std::move(value)), std::memory_order_relaxed);
+            } else {
+                insert_child(split, static_cast<uint8_t>(remain[match_prefix]),
+                             make_leaf_node(remain.substr(match_prefix), key, value));
+            }
+            replace_child(parent, parent_key, split);
+            node->write_unlock_obsolete();
+            parent->write_unlock();
+            EpochManager::instance().retire(node, &delete_node);
+            return true;
+        }
+
+        depth += match_prefix;
+        if (depth == key.length()) { // key ends at this node
+            if (!node->upgrade(version)) {
+                return false;
+            }
+            Leaf *old = node->leaf_.exchange(new Leaf(key, std::move(value)),
+                                             std::memory_order_acq_rel);
+            node->write_unlock();
+            if (old) {
+                EpochManager::instance().retire(old, &delete_leaf);
+            }
+            return true;
+        }
+
+        auto byte = static_cast<uint8_t>(key[depth]);
+        Node *next = find_child(node, byte);
+        if (!node->validate(version)) {
+            return false;
+        }
+        if (next == nullptr) {
+            if (is_full(node)) { // the root is a Node256 and never full, parent is set
+                if (!parent->upgrade(parent_version)) {
+                    return false;
+                }
+                if (!node->upgrade(version)) {
+                    parent->write_unlock();
+                    return false;
+                }
+                Node *bigger = copy(node, node->prefix_, true);
+                insert_child(bigger, byte, make_leaf_node(key.substr(depth), key, value));
+                replace_child(parent, parent_key, bigger);
+                node->write_unlock_obsolete();
+                parent->write_unlock();
+                EpochManager::instance().retire(node, &delete_node);
+                return true;
+            }
+            if (!node->upgrade(version)) {
+                return false;
+            }
+            insert_child(node, byte, make_leaf_node(key.substr(depth), key, value));
+            node->write_unlock();
+            return true;
+        }
+
+        if (parent && !parent->validate(parent_version)) {
+            return false;
+        }
+        parent = node;
+        parent_version = version;
+        parent_key = byte;
+        node = next;
+        if (!node->read_lock(version)) {
+            return false;
+        }
+    }
+}
+
+template <typename Value>
+bool ConcurrentAdaptiveRadixTree<Value>::try_search(std::string_view key,
+                                                    std::optional<Value> &result) const {
+    Node *node = root;
+    uint64_t version = 0;
+    if (!node->read_lock(version)) {
+        return false;
+    }
+
+    size_t depth = 0;
+    while (true) {
+        size_t match_prefix = node->match(key.substr(depth));
+        if (node->prefix_.length() > match_prefix) { // prefix not complete match
+            result.reset();
+            return node->validate(version);
+        }
+        depth += match_prefix;
+        if (depth == key.length()) {
+            Leaf *leaf = node->leaf_.load(std::memory_order_acquire);
+            if (!node->validate(version)) {
+                return false;
+            }
+            if (leaf) { // leaves are immutable and kept alive by the epoch guard
+                result.emplace(leaf->value);
+            } else {
+                result.reset();
+            }
+            return true;
+        }
+        Node *next = find_child(node, static_cast<uint8_t>(key[depth]));
+        if (!node->validate(version)) {
+            return false;
+        }
+        if (next == nullptr) {
+            result.reset();
+            return true;
+        }
+        node = next;
+        if (!node->read_lock(version)) {
+            return false;
+        }
+    }
+}
+
+template <typename Value>
+bool ConcurrentAdaptiveRadixTree<Value>::try_remove(std::string_view key, bool &removed) {
+    Node *parent = nullptr;
+    uint64_t parent_version = 0;
+    uint8_t parent_key = 0;
+    Node *node = root;
+    uint64_t version = 0;
+    if (!node->read_lock(version)) {
+        return false;
+    }
+
+    removed = false;
+    size_t depth = 0;
+    while (true) {
+        size_t match_prefix = node->match(key.substr(depth));
+        if (node->prefix_.length() > match_prefix) {
+            return node->validate(version);
+        }
+        depth += match_prefix;
+        if (depth == key.length()) {
+            Leaf *leaf = node->leaf_.load(std::memory_order_acquire);
+            bool has_children = node->size_.load(std::memory_order_relaxed) > 0;
+            if (!node->validate(version)) {
+                return false;
+            }
+            if (leaf == nullptr) {
+                return true;
+            }
+            if (parent && !has_children) { // drop the whole node
+                if (!parent->upgrade(parent_version)) {
+                    return false;
+                }
+                if (!node->upgrade(version)) {
+                    parent->write_unlock();
+                    return false;
+                }
+                remove_child(parent, parent_key);
+                node->write_unlock_obsolete();
+                parent->write_unlock();
+                EpochManager::instance().retire(node, &delete_node);
+            } else {
+                if (!node->upgrade(version)) {
+                    return false;
+                }
+                node->leaf_.store(nullptr, std::memory_order_release);
+                node->write_unlock();
+            }
+            EpochManager::instance().retire(leaf, &delete_leaf);
+            removed = true;
+            return true;
+        }
+
+        auto byte = static_cast<uint8_t>(key[depth]);
+        Node *next = find_child(node, byte);
+        if (!node->validate(version)) {
+            return false;
+        }
+        if (next == nullptr) {
+            return true;
+        }
+        if (parent && !parent->validate(parent_version)) {
+            return false;
+        }
+        parent = node;
+        parent_version = version;
+        parent_key = byte;
+        node = next;
+        if (!node->read_lock(version)) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Epoch based reclamation for lock-free readers.
+//
+// Readers wrap every access to shared nodes in an EpochGuard. Writers unlink a node and
+// hand it to retire(), it is freed once every thread that was inside a guard when it was
+// unlinked has left that guard.
+class EpochManager {
+    struct Retired {
+        void *ptr;
+        void (*deleter)(void *);
+        uint64_t epoch;
+    };
+
+    struct alignas(64) ThreadRecord {
+        std::atomic<uint64_t> epoch{Idle}; // epoch observed on enter, Idle outside a guard
+        size_t depth = 0;
+        std::vector<Retired> retired;
+
+        ThreadRecord() { instance().attach(this); }
+        ~ThreadRecord() { instance().detach(this); }
+    };
+
+  public:
+    static constexpr uint64_t Idle = 0;
+    static constexpr size_t CollectInterval = 64;
+
+    static EpochManager &instance() {
+        static EpochManager manager;
+        return manager;
+    }
+
+    void enter() {
+        ThreadRecord &record = local();
+        if (record.depth++ == 0) {
+            record.epoch.store(global_epoch_.load(std::memory_order_seq_cst),
+                               std::memory_order_seq_cst);
+            // loads of shared pointers must not move above the published epoch
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void exit() {
+        ThreadRecord &record = local();
+        if (--record.depth == 0) {
+            record.epoch.store(Idle, std::memory_order_release);
+        }
+    }
+
+    // ptr must already be unreachable for threads entering from now on
+    void retire(void *ptr, void (*deleter)(void *)) {
+        ThreadRecord &record = local();
+        record.retired.push_back({ptr, deleter, global_epoch_.load(std::memory_order_seq_cst)});
+        if (record.retired.size() % CollectInterval == 0) {
+            collect(record);
+        }
+    }
+
+    // Frees what can be freed from the calling thread's retire list.
+    void collect() { collect(local()); }
+
+    ~EpochManager() {
+        for (auto &retired : orphans_) {
+            retired.deleter(retired.ptr);
+        }
+    }
+
+  private:
+    EpochManager() = default;
+
+    static ThreadRecord &local() {
+        thread_local ThreadRecord record;
+        return record;
+    }
+
+    void attach(ThreadRecord *record) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.push_back(record);
+    }
+
+    void detach(ThreadRecord *record) {
+        collect(*record);
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.erase(std::find(records_.begin(), records_.end(), record));
+        orphans_.insert(orphans_.end(), record->retired.begin(), record->retired.end());
+    }
+
+    void collect(ThreadRecord &record) {
+        std::vector<Retired> freeable;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t global = global_epoch_.load(std::memory_order_seq_cst);
+            uint64_t oldest = global;
+            for (const ThreadRecord *other : records_) {
+                uint64_t epoch = other->epoch.load(std::memory_order_seq_cst);
+                if (epoch != Idle) {
+                    oldest = std::min(oldest, epoch);
+                }
+            }
+            if (oldest == global) { // every active thread has seen the current epoch
+                global_epoch_.fetch_add(1, std::memory_order_seq_cst);
+            }
+            // retired before the oldest active thread entered, nobody can still see them
+            auto unreachable = [oldest](const Retired &retired) { return retired.epoch < oldest; };
+            for (auto *list : {&record.retired, &orphans_}) {
+                auto it = std::stable_partition(list->begin(), list->end(), unreachable);
+                freeable.insert(freeable.end(), list->begin(), it);
+                list->erase(list->begin(), it);
+            }
+        }
+        for (auto &retired : freeable) {
+            retired.deleter(retired.ptr);
+        }
+    }
+
+    std::atomic<uint64_t> global_epoch_{1};
+    std::mutex mutex_;
+    std::vector<ThreadRecord *> records_;
+    std::vector<Retired> orphans_;
+};
+
+class EpochGuard {
+  public:
+    EpochGuard() { EpochManager::instance().enter(); }
+    ~EpochGuard() { EpochManager::instance().exit(); }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace co_io {
+
+// HDR style histogram of non-negative integers (latencies in ns). Values below 2^Precision
+// get a bucket each, above that every power of two range is split into 2^(Precision - 1)
+// equal buckets, so any recorded value is reported within a relative error of
+// 2^-(Precision - 1) using a few KB no matter how many values are recorded.
+class Histogram {
+  public:
+    static constexpr unsigned Precision = 8; // under 1% error
+
+    explicit Histogram(uint64_t max_value = uint64_t{1} << 40) // ~18 minutes in ns
+        : counts_(index_of(max_value) + 1) {}
+
+    void record(uint64_t value, uint64_t count = 1) noexcept {
+        size_t index = std::min(index_of(value), counts_.size() - 1);
+        counts_[index] += count;
+        total_ += count;
+        sum_ += value * count;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // histograms of the same max_value only
+    void merge(const Histogram &other) noexcept {
+        for (size_t i = 0; i < counts_.size() && i < other.counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() noexcept {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0;
+        min_ = std::numeric_limits<uint64_t>::max();
+        max_ = 0;
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return total_; }
+    [[nodiscard]] uint64_t min() const noexcept { return total_ ? min_ : 0; }
+    [[nodiscard]] uint64_t max() const noexcept { return max_; }
+    [[nodiscard]] double mean() const noexcept {
+        return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0;
+    }
+
+    // Smallest bucket bound with at least percentile % of the values at or below it, like
+    // HdrHistogram reports the highest value equivalent to the one found.
+    [[nodiscard]] uint64_t percentile(double percentile) const noexcept {
+        if (total_ == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(percentile / 100 * static_cast<double>(total_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, total_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) { // the last bucket also holds everything past max_value
+                return i + 1 == counts_.size() ? max_ : std::min(highest_equivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    // calls fn(lowest, highest, count) for every non-empty bucket in order
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (size_t i = 0; i < counts_.size(); i++) {
+            if (counts_[i] != 0) {
+                fn(lowest_equivalent(i), highest_equivalent(i), counts_[i]);
+            }
+        }
+    }
+
+  private:
+    friend class AtomicHistogram;
+
+    static constexpr uint64_t Half = uint64_t{1} << (Precision - 1);
+
+    // shift is how many low bits a bucket ignores, buckets of one shift are Half wide
+    static size_t index_of(uint64_t value) noexcept {
+        unsigned width = static_cast<unsigned>(std::bit_width(value));
+        unsigned shift = width > Precision ? width - Precision : 0;
+        return static_cast<size_t>(shift * Half + (value >> shift));
+    }
+
+    static unsigned shift_of(size_t index) noexcept {
+        return index < 2 * Half ? 0 : static_cast<unsigned>(index / Half - 1);
+    }
+
+    static uint64_t lowest_equivalent(size_t index) noexcept {
+        unsigned shift = shift_of(index);
+        return (index - shift * Half) << shift;
+    }
+
+    static uint64_t highest_equivalent(size_t index) noexcept {
+        unsigned shift = shift_of(index);
+        return lowest_equivalent(index) + (uint64_t{1} << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// Histogram any thread may record into without a lock, read by merging it into a Histogram
+// of the same max_value. Meant to be one per thread so recording stays uncontended, threads
+// that share one still count exactly.
+class AtomicHistogram {
+  public:
+    explicit AtomicHistogram(uint64_t max_value = uint64_t{1} << 40)
+        : counts_(Histogram::index_of(max_value) + 1) {}
+
+    void record(uint64_t value) noexcept {
+        size_t index = std::min(Histogram::index_of(value), counts_.size() - 1);
+        counts_[index].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        // compare_exchange keeps both exact when threads share a histogram, a value that
+        // changes neither costs only the loads
+        auto min = min_.load(std::memory_order_relaxed);
+        while (value < min && !min_.compare_exchange_weak(min, value, std::memory_order_relaxed)) {
+        }
+        auto max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // adds what was recorded so far, consistent per bucket
+    void merge_into(Histogram &histogram) const noexcept {
+        for (size_t i = 0; i < counts_.size() && i < histogram.counts_.size(); i++) {
+            auto count = counts_[i].load(std::memory_order_relaxed);
+            histogram.counts_[i] += count;
+            histogram.total_ += count;
+        }
+        histogram.sum_ += sum_.load(std::memory_order_relaxed);
+        histogram.min_ = std::min(histogram.min_, min_.load(std::memory_order_relaxed));
+        histogram.max_ = std::max(histogram.max_, max_.load(std::memory_order_relaxed));
+    }
+
+  private:
+    std::vector<std::atomic<uint64_t>> counts_;
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> max_{0};
+};
+
+} // namespace co_io
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Stack of trivially copyable values kept inline for the first N entries, deeper stacks
+// spill to the heap. Creating and copying a shallow stack never allocates.
+template <typename T, size_t N> class InlineStack {
+  public:
+    InlineStack() = default;
+    InlineStack(const InlineStack &other) { *this = other; }
+    InlineStack &operator=(const InlineStack &other) {
+        if (this != &other) {
+            size_ = 0;
+            reserve(other.size_);
+            std::copy_n(other.data(), other.size_, data());
+            size_ = other.size_;
+        }
+        return *this;
+    }
+    InlineStack(InlineStack &&other) noexcept { *this = std::move(other); }
+    InlineStack &operator=(InlineStack &&other) noexcept {
+        if (this != &other) {
+            inline_ = other.inline_;
+            heap_ = std::move(other.heap_);
+            capacity_ = std::exchange(other.capacity_, N);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+    ~InlineStack() = default;
+
+    void push(const T &value) {
+        if (size_ == capacity_) {
+            reserve(capacity_ * 2);
+        }
+        data()[size_++] = value;
+    }
+
+    void pop() noexcept {
+        assert(size_ > 0);
+        size_ -= 1;
+    }
+
+    T &top() noexcept {
+        assert(size_ > 0);
+        return data()[size_ - 1];
+    }
+    const T &top() const noexcept {
+        assert(size_ > 0);
+        return data()[size_ - 1];
+    }
+
+    void clear() noexcept { size_ = 0; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+  private:
+    T *data() noexcept { return heap_ ? heap_.get() : inline_.data(); }
+    const T *data() const noexcept { return heap_ ? heap_.get() : inline_.data(); }
+
+    void reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        auto heap = std::make_unique<T[]>(capacity);
+        std::copy_n(data(), size_, heap.get());
+        heap_ = std::move(heap);
+        capacity_ = capacity;
+    }
+
+    std::array<T, N> inline_{};
+    std::unique_ptr<T[]> heap_;
+    size_t capacity_ = N;
+    size_t size_ = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace co_io {
+
+// Bounded lock-free queue for many producers and one consumer. Every cell carries a
+// sequence number telling whose turn it is: pos when free for the producer that claimed
+// pos, pos + 1 once filled, so producers only contend on the tail counter.
+template <typename T> class MpscQueue {
+  public:
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+
+    // any thread, false when full
+    template <typename U> bool try_push(U &&value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) { // the consumer has not freed this cell yet
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only, false when empty
+    bool try_pop(T &value) {
+        Cell *cell = &cells_[head_ & mask_];
+        if (cell->sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return false;
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        head_ += 1;
+        return true;
+    }
+
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+};
+
+} // namespace co_io
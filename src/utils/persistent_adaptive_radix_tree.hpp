@@ -0,0 +1,646 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "utils/epoch.hpp"
+#include "utils/inline_stack.hpp"
+
+// AdaptiveRadixTree with copy-on-write versions: snapshot() returns an immutable view of the
+// tree as it is now, later writes do not change it.
+//
+// Nodes and leaves carry intrusive reference counts and are shared between versions. A write
+// copies the nodes on its path that are referenced more than once, everything else stays
+// shared. With no snapshot alive every count is one and writes update nodes in place.
+//
+// Writes, snapshot() and publish() need one writer at a time. Snapshots can be read, copied
+// and dropped on any thread. published() hands the last published version to any thread
+// without locking, versions replaced by publish() are released through EpochManager.
+// with_published() reads that version without a reference, so readers on many threads do
+// not contend on the count of its root. Nodes do not shrink on remove.
+template <typename Value> class PersistentAdaptiveRadixTree {
+    struct Node;
+    template <size_t Capacity> struct SmallNode;
+    struct Node48;
+    struct Node256;
+    using Node4 = SmallNode<4>;
+    using Node16 = SmallNode<16>;
+    enum class NodeType : uint8_t { N4, N16, N48, N256 };
+
+  public:
+    struct Leaf;
+    class Iterator;
+    class View;
+    class Snapshot;
+
+    PersistentAdaptiveRadixTree() : root(new Node4("")) { publish(); }
+    PersistentAdaptiveRadixTree(const PersistentAdaptiveRadixTree &) = delete;
+    PersistentAdaptiveRadixTree &operator=(const PersistentAdaptiveRadixTree &) = delete;
+
+    // no operation may be running on other threads, snapshots stay valid
+    ~PersistentAdaptiveRadixTree() {
+        release(root);
+        release(published_.load(std::memory_order_acquire));
+    }
+
+    void insert(std::string_view key, Value value);
+    bool remove(std::string_view key);
+    const Value *find(std::string_view key) const { return find(root, key); }
+    std::optional<Value> search(std::string_view key) const;
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    Snapshot snapshot() const; // the current version
+    void publish();            // the current version becomes the one published() returns
+    Snapshot published() const;
+    // Calls f(View) with the last published version and returns its result. The version
+    // stays alive until f returns, the view and what it points to must not be kept.
+    template <typename F> decltype(auto) with_published(F &&f) const {
+        EpochGuard guard;
+        return std::forward<F>(f)(View(published_.load(std::memory_order_acquire)));
+    }
+
+  private:
+    template <typename F> static decltype(auto) visit(Node *node, F &&f);
+    static Node *make_node(NodeType type, std::string_view prefix);
+    static Node **find_child(Node *node, uint8_t key) noexcept;
+    static Node *next_child(Node *node, int from, int &key) noexcept;
+    static void insert_child(Node *node, uint8_t key, Node *child) noexcept;
+    static void remove_child(Node *node, uint8_t key) noexcept;
+    static bool is_full(Node *node) noexcept;
+    static const Value *find(Node *root, std::string_view key) noexcept;
+
+    static Node *own(Node **slot);
+    static Node *copy_at(Node **slot, NodeType type);
+    static void merge(Node **slot);
+
+    static void retain(Node *node) noexcept { node->refs_.fetch_add(1, std::memory_order_relaxed); }
+    static void retain(Leaf *leaf) noexcept { leaf->refs_.fetch_add(1, std::memory_order_relaxed); }
+    static void release(Node *node) noexcept;
+    static void release(Leaf *leaf) noexcept;
+    static void release_node(void *node) noexcept { release(static_cast<Node *>(node)); }
+    static void delete_node(Node *node) noexcept;
+
+    Node *root;
+    size_t size_ = 0;
+    std::atomic<Node *> published_{nullptr};
+};
+
+template <typename Value> struct PersistentAdaptiveRadixTree<Value>::Leaf {
+    std::atomic<uint32_t> refs_{1};
+    const std::string key;
+    const Value value;
+
+    Leaf(std::string_view key, Value val) : key(key), value(std::move(val)) {}
+};
+
+template <typename Value> struct PersistentAdaptiveRadixTree<Value>::Node {
+    std::atomic<uint32_t> refs_{1};
+    uint16_t size_ = 0;
+    const NodeType type_;
+    std::string prefix_; // only changed while the node is not shared
+    Leaf *leaf_ = nullptr;
+
+    Node(std::string_view prefix, NodeType type) : type_(type), prefix_(prefix) {}
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    [[nodiscard]] size_t match(std::string_view match_prefix) const {
+        size_t i = 0;
+        for (i = 0; i < match_prefix.size() && i < prefix_.size(); i++) {
+            if (prefix_[i] != match_prefix[i]) {
+                break;
+            }
+        }
+        return i;
+    }
+};
+
+// Node4 and Node16, children sorted by key
+template <typename Value>
+template <size_t Capacity>
+struct PersistentAdaptiveRadixTree<Value>::SmallNode : public Node {
+    static constexpr size_t SIZE = Capacity;
+    std::array<uint8_t, SIZE> keys_{};
+    std::array<Node *, SIZE> childs_{};
+
+    explicit SmallNode(std::string_view prefix)
+        : Node(prefix, SIZE == 4 ? NodeType::N4 : NodeType::N16) {}
+
+    Node **find(uint8_t key) noexcept {
+        for (size_t i = 0; i < Node::size_; i++) {
+            if (keys_[i] == key) {
+                return &childs_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    Node *next(int from, int &key) const noexcept {
+        for (size_t i = 0; i < Node::size_; i++) {
+            if (keys_[i] >= from) {
+                key = keys_[i];
+                return childs_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        size_t i = Node::size_;
+        for (; i > 0 && keys_[i - 1] > key; i--) {
+            keys_[i] = keys_[i - 1];
+            childs_[i] = childs_[i - 1];
+        }
+        keys_[i] = key;
+        childs_[i] = child;
+        Node::size_ += 1;
+    }
+
+    void remove(uint8_t key) noexcept {
+        size_t i = 0;
+        while (keys_[i] != key) {
+            i += 1;
+        }
+        for (; i + 1 < Node::size_; i++) {
+            keys_[i] = keys_[i + 1];
+            childs_[i] = childs_[i + 1];
+        }
+        Node::size_ -= 1;
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t i = 0; i < Node::size_; i++) {
+            f(keys_[i], childs_[i]);
+        }
+    }
+};
+
+template <typename Value> struct PersistentAdaptiveRadixTree<Value>::Node48 : public Node {
+    static constexpr size_t SIZE = 48;
+    static constexpr uint8_t Empty = SIZE;
+    std::array<uint8_t, 256> index_;
+    std::array<Node *, SIZE> childs_{};
+
+    explicit Node48(std::string_view prefix) : Node(prefix, NodeType::N48) { index_.fill(Empty); }
+
+    Node **find(uint8_t key) noexcept {
+        return index_[key] == Empty ? nullptr : &childs_[index_[key]];
+    }
+
+    Node *next(int from, int &key) const noexcept {
+        for (int i = from; i < 256; i++) {
+            if (index_[i] != Empty) {
+                key = i;
+                return childs_[index_[i]];
+            }
+        }
+        return nullptr;
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        uint8_t slot = 0;
+        while (childs_[slot] != nullptr) {
+            slot += 1;
+        }
+        childs_[slot] = child;
+        index_[key] = slot;
+        Node::size_ += 1;
+    }
+
+    void remove(uint8_t key) noexcept {
+        childs_[index_[key]] = nullptr;
+        index_[key] = Empty;
+        Node::size_ -= 1;
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t key = 0; key < index_.size(); key++) {
+            if (index_[key] != Empty) {
+                f(static_cast<uint8_t>(key), childs_[index_[key]]);
+            }
+        }
+    }
+};
+
+template <typename Value> struct PersistentAdaptiveRadixTree<Value>::Node256 : public Node {
+    static constexpr size_t SIZE = 256;
+    std::array<Node *, SIZE> childs_{};
+
+    explicit Node256(std::string_view prefix) : Node(prefix, NodeType::N256) {}
+
+    Node **find(uint8_t key) noexcept { return childs_[key] ? &childs_[key] : nullptr; }
+
+    Node *next(int from, int &key) const noexcept {
+        for (int i = from; i < 256; i++) {
+            if (childs_[i]) {
+                key = i;
+                return childs_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void insert(uint8_t key, Node *child) noexcept {
+        childs_[key] = child;
+        Node::size_ += 1;
+    }
+
+    void remove(uint8_t key) noexcept {
+        childs_[key] = nullptr;
+        Node::size_ -= 1;
+    }
+
+    template <typename F> void for_each(F &&f) const {
+        for (size_t key = 0; key < SIZE; key++) {
+            if (childs_[key]) {
+                f(static_cast<uint8_t>(key), childs_[key]);
+            }
+        }
+    }
+};
+
+// Ordered forward iteration over one version.
+template <typename Value> class PersistentAdaptiveRadixTree<Value>::Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Leaf;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Leaf *;
+    using reference = const Leaf &;
+
+    Iterator() = default;
+
+    reference operator*() const { return *leaf_; }
+    pointer operator->() const { return leaf_; }
+
+    Iterator &operator++() {
+        advance();
+        return *this;
+    }
+    Iterator operator++(int) {
+        Iterator it = *this;
+        advance();
+        return it;
+    }
+
+    bool operator==(const Iterator &other) const { return leaf_ == other.leaf_; }
+    bool operator!=(const Iterator &other) const { return leaf_ != other.leaf_; }
+
+  private:
+    friend class View;
+
+    struct Frame {
+        Node *node;
+        int next; // next child key to visit, -1 before the node's own leaf
+    };
+
+    explicit Iterator(Node *root) {
+        stack_.push({root, -1});
+        advance();
+    }
+
+    void advance() {
+        leaf_ = nullptr;
+        while (!stack_.empty()) {
+            Frame &frame = stack_.top();
+            if (frame.next < 0) {
+                frame.next = 0;
+                if (frame.node->leaf_) {
+                    leaf_ = frame.node->leaf_;
+                    return;
+                }
+            }
+            int key = 0;
+            Node *child = frame.next < 256 ? next_child(frame.node, frame.next, key) : nullptr;
+            if (child == nullptr) {
+                stack_.pop();
+                continue;
+            }
+            frame.next = key + 1;
+            stack_.push({child, -1});
+        }
+    }
+
+    InlineStack<Frame, 32> stack_;
+    const Leaf *leaf_ = nullptr;
+};
+
+// A version of the tree read without holding it.
+template <typename Value> class PersistentAdaptiveRadixTree<Value>::View {
+  public:
+    View() = default;
+
+    const Value *find(std::string_view key) const {
+        return root_ ? PersistentAdaptiveRadixTree::find(root_, key) : nullptr;
+    }
+    std::optional<Value> search(std::string_view key) const {
+        if (const Value *value = find(key); value) {
+            return {*value};
+        }
+        return std::nullopt;
+    }
+
+    Iterator begin() const { return root_ ? Iterator(root_) : Iterator(); }
+    Iterator end() const { return Iterator(); }
+
+  protected:
+    friend class PersistentAdaptiveRadixTree;
+
+    explicit View(Node *root) : root_(root) {}
+
+    Node *root_ = nullptr;
+};
+
+// A version of the tree, holds one reference on its root.
+template <typename Value> class PersistentAdaptiveRadixTree<Value>::Snapshot : public View {
+    using View::root_;
+
+  public:
+    Snapshot() = default;
+    Snapshot(const Snapshot &other) : View(other.root_) {
+        if (root_) {
+            retain(root_);
+        }
+    }
+    Snapshot(Snapshot &&other) noexcept : View(std::exchange(other.root_, nullptr)) {}
+    Snapshot &operator=(Snapshot other) noexcept {
+        std::swap(root_, other.root_);
+        return *this;
+    }
+    ~Snapshot() {
+        if (root_) {
+            release(root_);
+        }
+    }
+
+  private:
+    friend class PersistentAdaptiveRadixTree;
+
+    explicit Snapshot(Node *root) : View(root) {} // takes over a reference
+};
+
+template <typename Value>
+template <typename F>
+decltype(auto) PersistentAdaptiveRadixTree<Value>::visit(Node *node, F &&f) {
+    switch (node->type_) {
+    case NodeType::N4:
+        return f(static_cast<Node4 *>(node));
+    case NodeType::N16:
+        return f(static_cast<Node16 *>(node));
+    case NodeType::N48:
+        return f(static_cast<Node48 *>(node));
+    case NodeType::N256:
+        break;
+    }
+    return f(static_cast<Node256 *>(node));
+}
+
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Node *
+PersistentAdaptiveRadixTree<Value>::make_node(NodeType type, std::string_view prefix) {
+    switch (type) {
+    case NodeType::N4:
+        return new Node4(prefix);
+    case NodeType::N16:
+        return new Node16(prefix);
+    case NodeType::N48:
+        return new Node48(prefix);
+    case NodeType::N256:
+        break;
+    }
+    return new Node256(prefix);
+}
+
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Node **
+PersistentAdaptiveRadixTree<Value>::find_child(Node *node, uint8_t key) noexcept {
+    return visit(node, [key](auto *n) { return n->find(key); });
+}
+
+// first child with a key >= from
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Node *
+PersistentAdaptiveRadixTree<Value>::next_child(Node *node, int from, int &key) noexcept {
+    return visit(node, [from, &key](auto *n) { return n->next(from, key); });
+}
+
+template <typename Value>
+void PersistentAdaptiveRadixTree<Value>::insert_child(Node *node, uint8_t key,
+                                                      Node *child) noexcept {
+    visit(node, [key, child](auto *n) { n->insert(key, child); });
+}
+
+template <typename Value>
+void PersistentAdaptiveRadixTree<Value>::remove_child(Node *node, uint8_t key) noexcept {
+    visit(node, [key](auto *n) { n->remove(key); });
+}
+
+template <typename Value> bool PersistentAdaptiveRadixTree<Value>::is_full(Node *node) noexcept {
+    return visit(node, [](auto *n) { return n->size_ >= std::decay_t<decltype(*n)>::SIZE; });
+}
+
+template <typename Value>
+const Value *PersistentAdaptiveRadixTree<Value>::find(Node *root, std::string_view key) noexcept {
+    Node *node = root;
+    size_t depth = 0;
+    while (true) {
+        size_t match_prefix = node->match(key.substr(depth));
+        if (node->prefix_.length() > match_prefix) { // prefix not complete match
+            return nullptr;
+        }
+        depth += match_prefix;
+        if (depth == key.length()) {
+            return node->leaf_ ? &node->leaf_->value : nullptr;
+        }
+        Node **next = find_child(node, static_cast<uint8_t>(key[depth]));
+        if (next == nullptr) {
+            return nullptr;
+        }
+        node = *next;
+    }
+}
+
+// The node at slot, copied first when another version references it too. The slot itself
+// must belong to a node the writer already owns.
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Node *PersistentAdaptiveRadixTree<Value>::own(Node **slot) {
+    Node *node = *slot;
+    if (node->refs_.load(std::memory_order_acquire) == 1) {
+        return node;
+    }
+    return copy_at(slot, node->type_);
+}
+
+// Replaces the node at slot by a copy of the given type sharing its children and leaf.
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Node *
+PersistentAdaptiveRadixTree<Value>::copy_at(Node **slot, NodeType type) {
+    Node *node = *slot;
+    Node *copy = make_node(type, node->prefix_);
+    if (node->leaf_) {
+        retain(node->leaf_);
+        copy->leaf_ = node->leaf_;
+    }
+    visit(node, [copy](auto *n) {
+        n->for_each([copy](uint8_t key, Node *child) {
+            retain(child);
+            insert_child(copy, key, child);
+        });
+    });
+    *slot = copy;
+    release(node);
+    return copy;
+}
+
+// Path compression after a remove: the owned node at slot has one child and no leaf.
+template <typename Value> void PersistentAdaptiveRadixTree<Value>::merge(Node **slot) {
+    Node *node = *slot;
+    int key = 0;
+    next_child(node, 0, key);
+    Node *child = own(find_child(node, static_cast<uint8_t>(key)));
+    child->prefix_.insert(0, node->prefix_);
+    *slot = child; // takes over the reference node held
+    delete_node(node);
+}
+
+template <typename Value> void PersistentAdaptiveRadixTree<Value>::release(Node *node) noexcept {
+    if (node->refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    visit(node, [](auto *n) { n->for_each([](uint8_t, Node *child) { release(child); }); });
+    if (node->leaf_) {
+        release(node->leaf_);
+    }
+    delete_node(node);
+}
+
+template <typename Value> void PersistentAdaptiveRadixTree<Value>::release(Leaf *leaf) noexcept {
+    if (leaf->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete leaf;
+    }
+}
+
+template <typename Value>
+void PersistentAdaptiveRadixTree<Value>::delete_node(Node *node) noexcept {
+    visit(node, [](auto *n) { delete n; });
+}
+
+template <typename Value>
+void PersistentAdaptiveRadixTree<Value>::insert(std::string_view key, Value value) {
+    Node **slot = &root;
+    size_t depth = 0;
+    while (true) {
+        Node *node = own(slot);
+        std::string_view remain = key.substr(depth);
+        size_t match_prefix = node->match(remain);
+        if (node->prefix_.length() > match_prefix) { // split, never happens at the root
+            Node *split = new Node4(remain.substr(0, match_prefix));
+            node->prefix_.erase(0, match_prefix);
+            insert_child(split, static_cast<uint8_t>(node->prefix_[0]), node);
+            *slot = split;
+            node = split;
+        }
+
+        depth += match_prefix;
+        if (depth == key.length()) { // key ends at this node
+            if (node->leaf_) {
+                release(node->leaf_);
+            } else {
+                size_ += 1;
+            }
+            node->leaf_ = new Leaf(key, std::move(value));
+            return;
+        }
+
+        auto byte = static_cast<uint8_t>(key[depth]);
+        if (Node **next = find_child(node, byte); next) {
+            slot = next;
+            continue;
+        }
+        if (is_full(node)) {
+            node = copy_at(slot, static_cast<NodeType>(static_cast<uint8_t>(node->type_) + 1));
+        }
+        Node *child = new Node4(key.substr(depth));
+        child->leaf_ = new Leaf(key, std::move(value));
+        insert_child(node, byte, child);
+        size_ += 1;
+        return;
+    }
+}
+
+template <typename Value> bool PersistentAdaptiveRadixTree<Value>::remove(std::string_view key) {
+    if (find(key) == nullptr) { // nothing to copy
+        return false;
+    }
+    InlineStack<Node **, 32> path;
+    Node **slot = &root;
+    size_t depth = 0;
+    while (true) {
+        Node *node = own(slot);
+        depth += node->prefix_.length(); // the key exists, every prefix on the way matches
+        if (depth == key.length()) {
+            break;
+        }
+        path.push(slot);
+        slot = find_child(node, static_cast<uint8_t>(key[depth]));
+    }
+
+    Node *node = *slot;
+    release(node->leaf_);
+    node->leaf_ = nullptr;
+    size_ -= 1;
+    if (slot == &root) {
+        return true;
+    }
+    if (node->size_ == 0) { // drop the node, its parent may be left with a single child
+        slot = path.top();
+        remove_child(*slot, static_cast<uint8_t>(node->prefix_[0]));
+        release(node);
+        node = *slot;
+        if (slot == &root || node->leaf_) {
+            return true;
+        }
+    }
+    if (node->size_ == 1) {
+        merge(slot);
+    }
+    return true;
+}
+
+template <typename Value>
+std::optional<Value> PersistentAdaptiveRadixTree<Value>::search(std::string_view key) const {
+    if (const Value *value = find(key); value) {
+        return {*value};
+    }
+    return std::nullopt;
+}
+
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Snapshot PersistentAdaptiveRadixTree<Value>::snapshot() const {
+    retain(root);
+    return Snapshot(root);
+}
+
+template <typename Value> void PersistentAdaptiveRadixTree<Value>::publish() {
+    retain(root);
+    if (Node *old = published_.exchange(root, std::memory_order_acq_rel); old) {
+        // a reader may have loaded old and not yet taken its reference
+        EpochManager::instance().retire(old, &release_node);
+    }
+}
+
+template <typename Value>
+PersistentAdaptiveRadixTree<Value>::Snapshot PersistentAdaptiveRadixTree<Value>::published() const {
+    EpochGuard guard;
+    Node *node = published_.load(std::memory_order_acquire);
+    retain(node);
+    return Snapshot(node);
+}
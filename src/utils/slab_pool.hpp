@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Allocation policies for AdaptiveRadixTree, the tree keeps one pool per node type.
+// A pool provides create(args...), destroy(ptr) and splice(other), which takes over
+// everything other has allocated so objects can outlive the pool that created them.
+
+// HeapPool is the default policy, every object is a plain new/delete.
+template <typename T> class HeapPool {
+  public:
+    template <typename... Args> T *create(Args &&...args) {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *ptr) noexcept { delete ptr; }
+
+    void splice(HeapPool &) noexcept {}
+};
+
+// SlabPool carves fixed size slots out of large slabs. Destroyed objects go to an
+// intrusive free list and are reused by the next create, memory goes back to the
+// system one slab at a time when the pool is destroyed.
+template <typename T, size_t SlabBytes = 64 * 1024> class SlabPool {
+    union Slot {
+        Slot *next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static constexpr size_t slots_per_slab() noexcept {
+        return std::max<size_t>(1, SlabBytes / sizeof(Slot));
+    }
+
+  public:
+    SlabPool() = default;
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    SlabPool(SlabPool &&other) noexcept
+        : slabs_(std::move(other.slabs_)), free_(std::exchange(other.free_, nullptr)),
+          used_(std::exchange(other.used_, 0)) {}
+    SlabPool &operator=(SlabPool &&other) noexcept {
+        std::swap(slabs_, other.slabs_);
+        std::swap(free_, other.free_);
+        std::swap(used_, other.used_);
+        return *this;
+    }
+    ~SlabPool() = default;
+
+    template <typename... Args> T *create(Args &&...args) {
+        Slot *slot = allocate();
+        try {
+            return std::construct_at(reinterpret_cast<T *>(slot->storage),
+                                     std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(slot);
+            throw;
+        }
+    }
+
+    void destroy(T *ptr) noexcept {
+        std::destroy_at(ptr);
+        deallocate(reinterpret_cast<Slot *>(ptr));
+    }
+
+    // Takes over other's slabs, objects created by other are destroyed through this pool
+    // from now on. Unused slots of other's last slab join the free list.
+    void splice(SlabPool &other) {
+        if (other.slabs_.empty()) {
+            return;
+        }
+        Slot *last = other.slabs_.back().get();
+        for (size_t i = other.used_; i < slots_per_slab(); i++) {
+            deallocate(&last[i]);
+        }
+        while (other.free_) {
+            deallocate(std::exchange(other.free_, other.free_->next));
+        }
+        // our last slab stays at the back and allocate() keeps carving from it, without
+        // one other's slabs are all handed out or free
+        if (slabs_.empty()) {
+            used_ = slots_per_slab();
+        }
+        slabs_.insert(slabs_.begin(), std::make_move_iterator(other.slabs_.begin()),
+                      std::make_move_iterator(other.slabs_.end()));
+        other.slabs_.clear();
+        other.used_ = 0;
+    }
+
+    [[nodiscard]] size_t slabs() const noexcept { return slabs_.size(); }
+    [[nodiscard]] static constexpr size_t slab_bytes() noexcept {
+        return slots_per_slab() * sizeof(Slot);
+    }
+
+  private:
+    Slot *allocate() {
+        if (free_) {
+            return std::exchange(free_, free_->next);
+        }
+        if (slabs_.empty() || used_ == slots_per_slab()) {
+            slabs_.emplace_back(new Slot[slots_per_slab()]);
+            used_ = 0;
+        }
+        return &slabs_.back()[used_++];
+    }
+
+    void deallocate(Slot *slot) noexcept {
+        slot->next = free_;
+        free_ = slot;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    Slot *free_ = nullptr;
+    size_t used_ = 0;
+};
@@ -52,6 +52,14 @@ template <typename T> class Execpted {
                is_errno(EWOULDBLOCK);
     }
 
+    // the error, or an empty error_code when there is a value
+    std::error_code error() const noexcept {
+        if (std::holds_alternative<std::error_code>(value_)) {
+            return std::get<std::error_code>(value_);
+        }
+        return {};
+    }
+
     std::string what() const noexcept {
         if (std::holds_alternative<std::error_code>(value_)) {
             return std::get<std::error_code>(value_).message();
@@ -0,0 +1,112 @@
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <netinet/in.h>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+#include "io/cpu.hpp"
+#include "io/loop.hpp"
+
+using namespace co_io;
+
+int connect_to(const sockaddr_in &addr) {
+    int fd = system_call(::socket(AF_INET, SOCK_STREAM, 0)).execption("socket");
+    system_call(::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)))
+        .execption("connect");
+    return fd;
+}
+
+// One wakeup drains the whole backlog in batches of at most out.size(), every socket comes
+// back nonblocking and close-on-exec with its peer address filled in.
+Task<void> accept_all(AsyncFile &listener, size_t clients, std::vector<int> &accepted,
+                      LoopBase &loop) {
+    std::array<AsyncFile::Accepted, 4> out;
+    while (accepted.size() < clients) {
+        auto ret = co_await listener.async_accept(out);
+        assert(!ret.is_error() && ret.value() > 0);
+        assert(static_cast<size_t>(ret.value()) <= out.size());
+        for (size_t i = 0; i < static_cast<size_t>(ret.value()); ++i) {
+            assert(fcntl(out[i].fd, F_GETFL) & O_NONBLOCK);
+            assert(fcntl(out[i].fd, F_GETFD) & FD_CLOEXEC);
+            assert(out[i].peer.addr_.sa_family == AF_INET);
+            assert(out[i].peer.len_ == sizeof(sockaddr_in));
+            accepted.push_back(out[i].fd);
+        }
+    }
+    loop.stop();
+}
+
+sockaddr_in local_address(int fd) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    system_call(::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len))
+        .execption("getsockname");
+    return addr;
+}
+
+// With this thread pinned, loopback connections arrive on its cpu and the CBPF program
+// must hand every one to the listener registered for that cpu.
+void test_reuseport_cpu() {
+    auto cpus = available_cpus();
+    assert(!cpus.empty());
+    pin_thread(cpus.back());
+    std::cerr << "cpu " << cpus.back() << " node " << numa_node(cpus.back()) << std::endl;
+
+    AddressSolver solver{"127.0.0.1", "0"};
+    FileDescriptor first(AsyncFile::create_listen(solver.get_address_info()));
+    auto addr = local_address(first.fd());
+    AddressSolver same{"127.0.0.1", std::to_string(ntohs(addr.sin_port))};
+    FileDescriptor second(AsyncFile::create_listen(same.get_address_info()));
+    std::vector<unsigned> order = {cpus.back() + 1, cpus.back()}; // no such cpu, then ours
+    AsyncFile::reuseport_by_cpu(first.fd(), 2, order);
+    AsyncFile::incoming_cpu(second.fd(), cpus.back());
+    fcntl(first.fd(), F_SETFL, O_NONBLOCK); // checked for emptiness below
+
+    std::vector<int> connected;
+    for (int i = 0; i < 8; ++i) {
+        connected.push_back(connect_to(addr));
+    }
+    for (int i = 0; i < 8; ++i) {
+        int fd = system_call(::accept4(second.fd(), nullptr, nullptr, SOCK_NONBLOCK))
+                     .execption("accept4");
+        ::close(fd);
+    }
+    assert(::accept4(first.fd(), nullptr, nullptr, SOCK_NONBLOCK) == -1 && errno == EAGAIN);
+    for (int fd : connected) {
+        ::close(fd);
+    }
+    std::cerr << "test_reuseport_cpu Count: " << connected.size() << std::endl;
+}
+
+int main() {
+    EPollLoop loop;
+    AddressSolver solver{"127.0.0.1", "0"};
+    AsyncFile listener = AsyncFile::bind(solver.get_address_info(), &loop);
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    system_call(::getsockname(listener.fd(), reinterpret_cast<sockaddr *>(&addr), &len))
+        .execption("getsockname");
+
+    const size_t clients = 37;
+    std::vector<int> connected;
+    for (size_t i = 0; i < clients; ++i) {
+        connected.push_back(connect_to(addr));
+    }
+    std::vector<int> accepted;
+    run_task(accept_all(listener, clients, accepted, loop));
+    loop.run();
+
+    assert(accepted.size() == clients);
+    for (int fd : accepted) {
+        ::close(fd);
+    }
+    for (int fd : connected) {
+        ::close(fd);
+    }
+    std::cerr << "test_accept Count: " << accepted.size() << std::endl;
+
+    test_reuseport_cpu();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/slab_pool.hpp"
+#include <map>
+#include <random>
+#include <vector>
+
+std::string randstring(std::mt19937 &rng) {
+    std::hash<uint64_t> hasher;
+    return std::to_string(hasher(rng())).substr(0, rng() % 21);
+}
+
+template <template <typename> class NodePool>
+void test(const std::vector<std::pair<std::string, int>> &sorted, size_t threads,
+          const std::string &name) {
+    std::map<std::string, int> expect;
+    for (const auto &[key, value] : sorted) {
+        expect[key] = value;
+    }
+
+    AdaptiveRadixTree<int, NodePool> tree;
+    tree.bulk_load(sorted.begin(), sorted.end(), threads);
+    auto it = tree.begin();
+    for (const auto &[key, value] : expect) {
+        if (it == tree.end() || it->key != key || it->value != value) {
+            std::cerr << name << " Error: " << key << " missing" << std::endl;
+            return;
+        }
+        ++it;
+    }
+    assert(it == tree.end());
+
+    // the bulk built nodes keep working with insert and remove
+    size_t i = 0;
+    for (const auto &[key, value] : expect) {
+        if (i++ % 2 == 0) {
+            assert(tree.remove(key));
+        } else {
+            tree.insert(key + "x", value);
+        }
+    }
+    i = 0;
+    for (const auto &[key, value] : expect) {
+        bool removed = i++ % 2 == 0;
+        if (tree.search(key).has_value() == removed) {
+            std::cerr << name << " Error: " << key << " -> unexpected search result"
+                      << std::endl;
+            return;
+        }
+        if (!removed && tree.search(key + "x") != value) {
+            std::cerr << name << " Error: " << key << "x missing" << std::endl;
+            return;
+        }
+    }
+    std::cerr << name << " Count: " << expect.size() << std::endl;
+}
+
+int main() {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::vector<std::pair<std::string, int>> sorted;
+    for (int i = 0; i < 200000; i++) { // includes duplicates, prefixes and the empty key
+        sorted.emplace_back(randstring(rng), i);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    test<HeapPool>(sorted, 1, "heap");
+    test<HeapPool>(sorted, 4, "heap_parallel");
+    test<SlabPool>(sorted, 1, "slab");
+    test<SlabPool>(sorted, 4, "slab_parallel");
+
+    // loading into a non-empty tree inserts
+    AdaptiveRadixTree<int> tree;
+    tree.insert("a", 1);
+    tree.bulk_load(sorted.begin(), sorted.end());
+    assert(tree.search("a").has_value());
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "utils/adaptive_radix_tree.hpp"
 #include <fstream>
+#include <memory>
 #include <random>
 #include <set>
 #include <unordered_map>
@@ -127,12 +128,38 @@ void test256() {
     tree.debug();
 }
 
+// move-only value, find/insert_or_assign/emplace never copy it
+struct Heavy {
+    explicit Heavy(int v) : value(std::make_unique<int>(v)) {}
+    std::unique_ptr<int> value;
+};
+
+void test_in_place() {
+    AdaptiveRadixTree<Heavy> tree;
+    auto [value, inserted] = tree.emplace("abc", 1);
+    assert(inserted && *value->value == 1);
+    std::tie(value, inserted) = tree.emplace("abc", 2); // existing value is kept
+    assert(!inserted && *value->value == 1);
+    std::tie(value, inserted) = tree.insert_or_assign("abd", Heavy(3));
+    assert(inserted && *value->value == 3);
+    std::tie(value, inserted) = tree.insert_or_assign("abc", Heavy(4));
+    assert(!inserted && *value->value == 4);
+    assert(tree.find("abc") == value && *tree.find("abd")->value == 3);
+    assert(tree.find("ab") == nullptr && tree.find("abcd") == nullptr);
+
+    const auto &const_tree = tree;
+    *tree.find("abd")->value = 5;
+    assert(*const_tree.find("abd")->value == 5);
+    assert(tree.remove("abd") && const_tree.find("abd") == nullptr);
+}
+
 int main(int argc, char *argv[]) {
     test1();
     test2();
     test3();
     test4();
     test5();
+    test_in_place();
     test_random(1000000);
     if (argc > 1) {
         test_file(argv[1]);
@@ -0,0 +1,121 @@
+#include "utils/adaptive_radix_tree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// iteration order, lookups and bounds of a native key tree must match std::map
+template <typename Key>
+void test(const std::vector<Key> &keys, const std::vector<Key> &queries, const std::string &name) {
+    std::map<Key, int> expect;
+    AdaptiveRadixTree<int, HeapPool, Key> tree;
+    for (size_t i = 0; i < keys.size(); i++) {
+        expect[keys[i]] = static_cast<int>(i);
+        tree.insert(keys[i], static_cast<int>(i));
+    }
+
+    auto it = tree.begin();
+    for (const auto &[key, value] : expect) {
+        if (it == tree.end() || it->key != key || it->value != value) {
+            std::cerr << name << " Error: iteration order" << std::endl;
+            return;
+        }
+        ++it;
+    }
+    assert(it == tree.end());
+
+    for (const auto &key : queries) {
+        auto lower = tree.lower_bound(key);
+        auto expect_lower = expect.lower_bound(key);
+        if ((lower == tree.end()) != (expect_lower == expect.end()) ||
+            (lower != tree.end() && lower->key != expect_lower->first)) {
+            std::cerr << name << " Error: lower_bound" << std::endl;
+            return;
+        }
+        if (tree.search(key).has_value() != expect.contains(key)) {
+            std::cerr << name << " Error: search" << std::endl;
+            return;
+        }
+    }
+
+    size_t i = 0;
+    for (const auto &[key, value] : expect) {
+        if (i++ % 2 == 0) {
+            assert(tree.remove(key));
+        }
+    }
+    i = 0;
+    for (const auto &[key, value] : expect) {
+        if (tree.search(key).has_value() != (i++ % 2 == 1)) {
+            std::cerr << name << " Error: remove" << std::endl;
+            return;
+        }
+    }
+    std::cerr << name << " Count: " << expect.size() << std::endl;
+}
+
+void test_bulk(std::mt19937 &rng) {
+    std::vector<std::pair<int64_t, int>> sorted;
+    for (int i = 0; i < 10000; i++) {
+        sorted.emplace_back(static_cast<int64_t>(rng()) - (1ll << 31), i);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    AdaptiveRadixTree<int, HeapPool, int64_t> tree;
+    tree.bulk_load(sorted.begin(), sorted.end());
+    auto it = tree.begin();
+    int64_t last = std::numeric_limits<int64_t>::min();
+    for (; it != tree.end(); ++it) {
+        assert(it->key >= last);
+        last = it->key;
+    }
+
+    std::vector<int64_t> keys = {sorted[0].first, 0, sorted.back().first};
+    std::vector<int *> results(keys.size());
+    tree.search_batch(keys, results);
+    assert(results[0] != nullptr && results[2] != nullptr);
+    auto range = tree.range(sorted[10].first, sorted[20].first);
+    assert(std::distance(range.begin(), range.end()) <= 10);
+}
+
+int main() {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+
+    std::vector<uint64_t> u64;
+    std::vector<int32_t> i32;
+    std::vector<int64_t> i64;
+    std::vector<double> f64;
+    std::vector<std::tuple<uint16_t, int32_t>> pairs;
+    // no -0.0, std::map treats it as 0.0 while the tree keeps both
+    for (double special : {0.0, 1.0, -1.0, std::numeric_limits<double>::infinity(),
+                           -std::numeric_limits<double>::infinity(),
+                           std::numeric_limits<double>::denorm_min()}) {
+        f64.push_back(special);
+    }
+    for (int i = 0; i < 100000; i++) {
+        u64.push_back((static_cast<uint64_t>(rng()) << 32) | rng());
+        i32.push_back(static_cast<int32_t>(rng()));
+        i64.push_back(static_cast<int64_t>(u64.back()));
+        auto exponent = static_cast<int>(rng() % 64) - 32;
+        f64.push_back(std::ldexp(static_cast<double>(i32.back()), exponent));
+        auto second = static_cast<int32_t>(rng() % 200) - 100;
+        pairs.emplace_back(static_cast<uint16_t>(rng() % 16), second);
+    }
+    auto half = [](const auto &keys) {
+        return std::vector(keys.begin(), keys.begin() + static_cast<ptrdiff_t>(keys.size() / 2));
+    };
+
+    test(half(u64), u64, "uint64");
+    test(half(i32), i32, "int32");
+    test(half(i64), i64, "int64");
+    test(half(f64), f64, "double");
+    test(half(pairs), pairs, "tuple");
+    test_bulk(rng);
+    return 0;
+}
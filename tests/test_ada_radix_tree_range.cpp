@@ -0,0 +1,129 @@
+#include "utils/adaptive_radix_tree.hpp"
+#include <random>
+#include <set>
+#include <vector>
+
+// short keys over a small alphabet, so keys are often prefixes of each other
+std::string randkey(std::mt19937 &rng) {
+    static const char alphabet[] = {'a', 'b', 'c', '\x7f', '\x80', '\xff'};
+    std::string key(rng() % 6, ' ');
+    for (auto &c : key) {
+        c = alphabet[rng() % sizeof(alphabet)];
+    }
+    return key;
+}
+
+template <typename It, typename SetIt>
+bool same(It first, It last, SetIt expect_first, SetIt expect_last) {
+    for (; first != last && expect_first != expect_last; ++first, ++expect_first) {
+        if (first->key != *expect_first) {
+            return false;
+        }
+    }
+    return first == last && expect_first == expect_last;
+}
+
+void test_random(size_t n, size_t queries) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::set<std::string> words;
+    AdaptiveRadixTree<int> tree;
+    for (size_t i = 0; i < n; i++) {
+        auto word = randkey(rng);
+        words.insert(word);
+        tree.insert(word, 1);
+    }
+
+    if (!same(tree.rbegin(), tree.rend(), words.rbegin(), words.rend())) {
+        std::cerr << "reverse iteration failed" << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < queries; i++) {
+        auto key = randkey(rng);
+        auto lower = tree.lower_bound(key);
+        auto expect_lower = words.lower_bound(key);
+        if ((lower == tree.end()) != (expect_lower == words.end()) ||
+            (lower != tree.end() && lower->key != *expect_lower)) {
+            std::cerr << "lower_bound " << key << " failed" << std::endl;
+            return;
+        }
+        if (!same(tree.upper_bound(key), tree.end(), words.upper_bound(key), words.end())) {
+            std::cerr << "upper_bound " << key << " failed" << std::endl;
+            return;
+        }
+
+        auto prefix = tree.scan_prefix(key);
+        std::vector<std::string> expect_prefix;
+        for (auto it = words.lower_bound(key); it != words.end() && it->starts_with(key); ++it) {
+            expect_prefix.push_back(*it);
+        }
+        if (!same(prefix.begin(), prefix.end(), expect_prefix.begin(), expect_prefix.end())) {
+            std::cerr << "scan_prefix " << key << " failed" << std::endl;
+            return;
+        }
+
+        auto to = randkey(rng);
+        auto range = tree.range(key, to);
+        auto expect_first = words.lower_bound(key);
+        auto expect_last = key < to ? words.lower_bound(to) : expect_first;
+        if (!same(range.begin(), range.end(), expect_first, expect_last)) {
+            std::cerr << "range " << key << " " << to << " failed" << std::endl;
+            return;
+        }
+
+        // step back from the lower bound
+        if (expect_lower != words.begin()) {
+            --lower;
+            --expect_lower;
+            if (lower->key != *expect_lower) {
+                std::cerr << "operator-- from " << key << " failed" << std::endl;
+                return;
+            }
+        }
+    }
+    std::cerr << "test_random Count: " << words.size() << std::endl;
+}
+
+void test_empty() {
+    AdaptiveRadixTree<int> tree;
+    assert(tree.begin() == tree.end());
+    assert(tree.rbegin() == tree.rend());
+    assert(tree.lower_bound("a") == tree.end());
+    assert(tree.scan_prefix("").begin() == tree.end());
+    tree.insert("", 1);
+    assert(tree.begin()->key.empty());
+    assert(tree.lower_bound("") == tree.begin());
+    assert(tree.upper_bound("") == tree.end());
+}
+
+// every prefix of a long key is a key too, paths are deeper than the iterator's inline stack
+void test_deep(size_t depth) {
+    AdaptiveRadixTree<int> tree;
+    std::set<std::string> words;
+    std::string key;
+    for (size_t i = 0; i < depth; i++) {
+        key.push_back(static_cast<char>('a' + i % 2));
+        words.insert(key);
+        words.insert(key + "z");
+        tree.insert(key, 1);
+        tree.insert(key + "z", 1);
+    }
+    auto copy = tree.lower_bound(key);
+    assert(copy->key == key);
+    auto it = copy;
+    assert(same(it, tree.end(), words.find(key), words.end()));
+    assert(same(tree.begin(), tree.end(), words.begin(), words.end()));
+    assert(same(tree.rbegin(), tree.rend(), words.rbegin(), words.rend()));
+    std::cerr << "test_deep Count: " << words.size() << std::endl;
+}
+
+int main() {
+    test_empty();
+    test_deep(200);
+    test_random(1000, 10000);
+    test_random(100000, 10000);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/slab_pool.hpp"
+#include <random>
+#include <set>
+#include <vector>
+
+std::string randstring(std::mt19937 &rng) {
+    std::hash<uint64_t> hasher;
+    return std::to_string(hasher(rng()));
+}
+
+void test_pool() {
+    SlabPool<std::string, 256> pool;
+    std::vector<std::string *> items;
+    for (int i = 0; i < 100; i++) {
+        items.push_back(pool.create(std::to_string(i)));
+    }
+    size_t slabs = pool.slabs();
+    for (auto *item : items) {
+        pool.destroy(item);
+    }
+    items.clear();
+    for (int i = 0; i < 100; i++) { // freed slots are reused, no new slab
+        items.push_back(pool.create(std::to_string(i)));
+    }
+    assert(pool.slabs() == slabs);
+    for (int i = 0; i < 100; i++) {
+        assert(*items[i] == std::to_string(i));
+    }
+}
+
+void test_random(size_t n) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::set<std::string> words;
+    for (size_t i = 0; i < n; i++) {
+        words.insert(randstring(rng));
+    }
+
+    AdaptiveRadixTree<int, SlabPool> tree;
+    for (const auto &word : words) {
+        tree.insert(word, static_cast<int>(word.size()));
+    }
+
+    // remove every other word, grow/shrink recycle the freed node slots
+    size_t i = 0;
+    for (const auto &word : words) {
+        if (i++ % 2 == 0 && !tree.remove(word)) {
+            std::cerr << "remove " << word << " failed" << std::endl;
+            return;
+        }
+    }
+    i = 0;
+    for (const auto &word : words) {
+        auto result = tree.search(word);
+        if ((i++ % 2 == 0) == result.has_value()) {
+            std::cerr << word << " -> unexpected search result" << std::endl;
+            return;
+        }
+    }
+
+    AdaptiveRadixTree<int, SlabPool> moved = std::move(tree);
+    size_t count = 0;
+    for (auto it = moved.begin(); it != moved.end(); ++it) {
+        count += 1;
+    }
+    std::cerr << "test_random Count: " << count << std::endl;
+    assert(count == words.size() / 2);
+}
+
+int main() {
+    test_pool();
+    test_random(100000);
+    return 0;
+}
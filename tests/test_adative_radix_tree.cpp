@@ -91,6 +91,54 @@ void test256() {
 }
 
 
+void test_search_batch(size_t n) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::hash<uint64_t> hasher;
+    AdaptiveRadixTree<int> tree;
+    std::vector<std::string> words;
+    for (size_t i = 0; i < n; i++) { // every other word is missing
+        words.push_back(std::to_string(hasher(rng())).substr(0, rng() % 21));
+        if (i % 2 == 0) {
+            tree.insert(words.back(), static_cast<int>(words.back().size()));
+        }
+    }
+    std::vector<std::string_view> keys(words.begin(), words.end());
+    std::vector<int *> results(keys.size());
+    tree.search_batch(keys, results);
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto expect = tree.search(keys[i]);
+        if (expect.has_value() != (results[i] != nullptr) || (expect && *expect != *results[i])) {
+            std::cerr << keys[i] << " -> unexpected search_batch result" << std::endl;
+            return;
+        }
+    }
+}
+
+void test_stats() {
+    AdaptiveRadixTree<int> tree;
+    for (uint16_t i = 0; i < 256; i++) {
+        tree.insert(std::string(1, static_cast<char>(i)), 1);
+    }
+    auto stats = tree.stats();
+    assert(stats.nodes[3] == 1 && stats.nodes[0] == 256 && stats.total_nodes() == 257);
+    assert(stats.leaves == 256 && stats.max_depth == 1 && stats.avg_depth == 1.0);
+    assert(stats.prefix_lengths[0] == 1 && stats.prefix_lengths[1] == 256);
+    assert(stats.prefix_bytes == 0 && stats.key_bytes == 0);
+    assert(stats.fill_factor == 256.0 / (256 + 256 * 4));
+
+    std::string long_key(40, 'x'); // longer than the inline string buffer
+    tree.insert(long_key, 1);
+    stats = tree.stats();
+    assert(stats.leaves == 257 && stats.max_depth == 2);
+    assert(stats.prefix_lengths[AdaptiveRadixTree<int>::Stats::PrefixBuckets - 1] == 1);
+    assert(stats.prefix_bytes > 0 && stats.key_bytes > long_key.size());
+    assert(stats.total_bytes() == stats.node_bytes + stats.prefix_bytes + stats.leaf_bytes +
+                                      stats.key_bytes);
+}
+
 int main(int argc, char *argv[]) {
     test1();
     test2();
@@ -98,5 +146,7 @@ int main(int argc, char *argv[]) {
         test_file(argv[1]);
     }
     test256();
+    test_search_batch(100000);
+    test_stats();
     return 0;
 }
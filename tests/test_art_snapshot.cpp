@@ -0,0 +1,137 @@
+#include "utils/adaptive_radix_tree.hpp"
+#include "utils/art_snapshot.hpp"
+#include <fcntl.h>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+std::string randstring(std::mt19937 &rng) {
+    std::hash<uint64_t> hasher;
+    return std::to_string(hasher(rng())).substr(0, rng() % 21);
+}
+
+void test_random(size_t n) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::map<std::string, uint64_t> words;
+    AdaptiveRadixTree<uint64_t> tree;
+    for (size_t i = 0; i < n; i++) { // includes prefixes of other keys and the empty key
+        auto word = randstring(rng);
+        words[word] = i;
+        tree.insert(word, i);
+    }
+
+    std::string path = "/tmp/test_art_snapshot." + std::to_string(::getpid());
+    ArtSnapshot<uint64_t>::write(tree, path);
+    ArtSnapshot<uint64_t> snapshot(path);
+    ::unlink(path.c_str()); // the mapping stays valid
+    assert(snapshot.size() == words.size());
+
+    for (const auto &[word, value] : words) {
+        if (snapshot.search(word) != value) {
+            std::cerr << word << " -> unexpected search result" << std::endl;
+            return;
+        }
+        if (snapshot.search(word + "#").has_value()) {
+            std::cerr << word << "# -> unexpected search result" << std::endl;
+            return;
+        }
+    }
+
+    auto expect = words.begin();
+    size_t count = 0;
+    for (auto [key, value] : snapshot) {
+        if (expect == words.end() || key != expect->first || value != expect->second) {
+            std::cerr << key << " -> unexpected iteration result" << std::endl;
+            return;
+        }
+        ++expect;
+        count += 1;
+    }
+    assert(expect == words.end());
+    std::cerr << "test_random Count: " << count << std::endl;
+}
+
+void test_empty() {
+    AdaptiveRadixTree<int> tree;
+    std::string path = "/tmp/test_art_snapshot_empty." + std::to_string(::getpid());
+    ArtSnapshot<int>::write(tree, path);
+    ArtSnapshot<int> snapshot(path);
+    ::unlink(path.c_str());
+    assert(snapshot.size() == 0);
+    assert(snapshot.begin() == snapshot.end());
+    assert(!snapshot.search("").has_value());
+    assert(!snapshot.search("a").has_value());
+
+    bool thrown = false;
+    try {
+        ArtSnapshot<int> missing(path);
+    } catch (const std::system_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// Overwrites the uint64_t at offset of the file at path.
+void patch(const std::string &path, uint64_t offset, uint64_t value) {
+    int fd = co_io::system_call(::open(path.c_str(), O_WRONLY)).execption("open");
+    co_io::system_call(::pwrite(fd, &value, sizeof(value), static_cast<off_t>(offset)))
+        .execption("pwrite");
+    ::close(fd);
+}
+
+template <typename F> bool corrupt(F &&f) {
+    try {
+        f();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// damaged offsets throw instead of reading outside the mapping or looping
+void test_corrupt() {
+    AdaptiveRadixTree<uint64_t> tree;
+    for (const char *key : {"a", "b", "c"}) {
+        tree.insert(key, 1);
+    }
+    std::string path = "/tmp/test_art_snapshot_corrupt." + std::to_string(::getpid());
+    ArtSnapshot<uint64_t>::write(tree, path);
+    uint64_t root = 0;
+    uint64_t file_size = 0;
+    {
+        int fd = co_io::system_call(::open(path.c_str(), O_RDONLY)).execption("open");
+        co_io::system_call(::pread(fd, &root, sizeof(root), 24)).execption("pread");
+        co_io::system_call(::pread(fd, &file_size, sizeof(file_size), 32)).execption("pread");
+        ::close(fd);
+    }
+    // the root's 3 sorted keys are padded to 8 bytes, the child offsets follow
+    uint64_t first_child = root + 16 + 8;
+
+    patch(path, 24, file_size - 8);
+    assert(corrupt([&] { ArtSnapshot<uint64_t> snapshot(path); }));
+    patch(path, 24, root);
+
+    for (uint64_t child : {file_size + 4096, root, uint64_t{8}}) {
+        patch(path, first_child, child);
+        ArtSnapshot<uint64_t> snapshot(path);
+        assert(corrupt([&] { (void)snapshot.search("a"); }));
+        assert(corrupt([&] {
+            for (auto entry : snapshot) {
+                (void)entry;
+            }
+        }));
+        assert(snapshot.search("b") == 1u);
+    }
+    ::unlink(path.c_str());
+    std::cerr << "test_corrupt Count: 3" << std::endl;
+}
+
+int main() {
+    test_empty();
+    test_corrupt();
+    test_random(200000);
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <sys/socket.h>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+#include "utils/chain_buffer.hpp"
+
+using namespace co_io;
+
+std::string randbytes(std::mt19937 &rng, size_t size) {
+    std::string data(size, ' ');
+    for (auto &c : data) {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+// Random appends, prepare/commit and consumes across segment boundaries must behave like a
+// std::string used as a queue, and drained segments must go back to the pool.
+void test_queue(std::mt19937 &rng, size_t ops) {
+    SegmentPool pool;
+    std::string expect;
+    {
+        ChainBuffer buf(pool);
+        for (size_t i = 0; i < ops; i++) {
+            auto size = rng() % (BufferSegment::Size * 3);
+            switch (rng() % 3) {
+            case 0: {
+                auto data = randbytes(rng, size);
+                buf.append(data);
+                expect += data;
+                break;
+            }
+            case 1: {
+                iovec iov[4];
+                auto count = buf.prepare(size, iov);
+                size_t available = 0;
+                for (size_t j = 0; j < count; j++) {
+                    available += iov[j].iov_len;
+                }
+                assert(available >= size);
+                auto data = randbytes(rng, size);
+                size_t offset = 0;
+                for (size_t j = 0; j < count && offset < size; j++) {
+                    auto step = std::min(iov[j].iov_len, size - offset);
+                    std::memcpy(iov[j].iov_base, data.data() + offset, step);
+                    offset += step;
+                }
+                buf.commit(size);
+                expect += data;
+                break;
+            }
+            default: {
+                size = std::min(size, buf.size());
+                std::string got;
+                while (got.size() < size) {
+                    auto front = buf.front();
+                    front = front.substr(0, size - got.size());
+                    got.append(front);
+                    buf.consume(front.size());
+                }
+                assert(got == expect.substr(0, size));
+                expect.erase(0, size);
+            }
+            }
+            assert(buf.size() == expect.size());
+        }
+        if (buf.str() != expect) {
+            std::cerr << "Error: contents" << std::endl;
+            return;
+        }
+        buf.consume(buf.size());
+        assert(buf.empty() && buf.front().empty());
+    }
+    std::cerr << "test_queue Cached: " << pool.cached() << std::endl;
+}
+
+// readable iovecs cover the buffer in order, compact keeps the bytes
+void test_iovecs() {
+    SegmentPool pool;
+    ChainBuffer buf(pool);
+    std::string data(BufferSegment::Size * 2 + 100, 'x');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    buf.append(data);
+    iovec iov[4];
+    assert(buf.readable(iov) == 3);
+    assert(iov[0].iov_len + iov[1].iov_len + iov[2].iov_len == data.size());
+    assert(buf.readable(std::span(iov, 2)) == 2);
+
+    buf.consume(BufferSegment::Size * 2 + 10);
+    assert(pool.cached() == 2);
+    buf.compact();
+    assert(buf.front() == std::string_view(data).substr(BufferSegment::Size * 2 + 10));
+    assert(buf.prepare(BufferSegment::Size - 90, iov) == 1);
+    assert(iov[0].iov_len == BufferSegment::Size - 90);
+
+    ChainBuffer moved = std::move(buf);
+    assert(buf.empty() && moved.size() == 90);
+}
+
+// prepare takes only the segments it hands out, a cleared buffer gives all of them back
+void test_prepare() {
+    SegmentPool pool;
+    ChainBuffer buf(pool);
+    iovec iov[4];
+    assert(buf.prepare(100, iov) == 1);
+    buf.commit(10);
+    buf.clear();
+    assert(pool.cached() == 1);
+
+    assert(buf.prepare(BufferSegment::Size + 1, iov) == 2);
+    buf.commit(BufferSegment::Size + 1);
+    assert(buf.prepare(BufferSegment::Size - 1, iov) == 1);
+    buf.clear();
+    assert(pool.cached() == 2);
+
+    assert(buf.prepare(BufferSegment::Size * 8, std::span(iov, 2)) == 2);
+    assert(buf.prepare(0, iov) == 0);
+    buf.clear();
+    assert(pool.cached() == 2);
+}
+
+Task<void> write_all(AsyncFile &file, std::string_view data) {
+    ChainBuffer out(*file.loop()->buffers());
+    out.append(data);
+    auto ret = co_await file.async_writev(out);
+    assert(!ret.is_error() && static_cast<size_t>(ret.value()) == data.size() && out.empty());
+}
+
+Task<void> read_all(AsyncFile &file, std::string &received, size_t size, LoopBase &loop) {
+    ChainBuffer in(*file.loop()->buffers());
+    while (received.size() < size) {
+        auto ret = co_await file.async_read(in);
+        assert(!ret.is_error() && ret.value() > 0);
+        while (!in.empty()) {
+            received.append(in.front());
+            in.consume(in.front().size());
+        }
+    }
+    loop.stop();
+}
+
+// async_read and async_writev move a large payload through a socketpair in pieces
+void test_socket(std::mt19937 &rng, size_t size) {
+    int fds[2];
+    system_call(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)).execption("socketpair");
+    EPollLoop loop;
+    AsyncFile reader(fds[0], &loop);
+    AsyncFile writer(fds[1], &loop);
+    auto data = randbytes(rng, size);
+    std::string received;
+
+    run_task(write_all(writer, data));
+    run_task(read_all(reader, received, size, loop));
+    loop.run();
+
+    if (received != data) {
+        std::cerr << "Error: socket" << std::endl;
+        return;
+    }
+    // every segment went back to the loop once the buffers drained
+    assert(loop.buffers()->cached() > 0);
+    std::cerr << "test_socket Count: " << received.size() << std::endl;
+}
+
+int main() {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+
+    test_queue(rng, 2000);
+    test_iovecs();
+    test_prepare();
+    test_socket(rng, 1 << 22);
+    return 0;
+}
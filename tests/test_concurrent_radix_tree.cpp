@@ -0,0 +1,102 @@
+#include "utils/concurrent_adaptive_radix_tree.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+std::string randstring(std::mt19937 &rng) {
+    std::hash<uint64_t> hasher;
+    return std::to_string(hasher(rng()));
+}
+
+void test_basic() {
+    ConcurrentAdaptiveRadixTree<int> tree;
+    tree.insert("", 0);
+    tree.insert("abc", 1);
+    tree.insert("abd", 2);
+    tree.insert("ab", 3);
+    tree.insert("abc", 4);
+    assert(tree.search("").value() == 0);
+    assert(tree.search("abc").value() == 4);
+    assert(tree.search("abd").value() == 2);
+    assert(tree.search("ab").value() == 3);
+    assert(!tree.search("a").has_value());
+    assert(!tree.search("abcd").has_value());
+    assert(tree.remove("ab"));
+    assert(!tree.remove("ab"));
+    assert(!tree.search("ab").has_value());
+    assert(tree.search("abc").value() == 4);
+    assert(tree.remove(""));
+    assert(!tree.search("").has_value());
+}
+
+// Writers insert and then remove disjoint key sets while readers search all of them,
+// a reader must only ever see the value a key was inserted with.
+void test_threads(size_t n, size_t threads) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+    std::set<std::string> unique;
+    while (unique.size() < n) {
+        unique.insert(randstring(rng));
+    }
+    std::vector<std::string> words(unique.begin(), unique.end());
+    std::shuffle(words.begin(), words.end(), rng);
+
+    ConcurrentAdaptiveRadixTree<size_t> tree;
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threads; t++) {
+        readers.emplace_back([&, t] {
+            std::mt19937 local(t);
+            while (!done.load()) {
+                size_t i = local() % words.size();
+                auto result = tree.search(words[i]);
+                assert(!result.has_value() || *result == i);
+                (void)result;
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; t++) {
+        writers.emplace_back([&, t] {
+            for (size_t i = t; i < words.size(); i += threads) {
+                tree.insert(words[i], i);
+            }
+            for (size_t i = t; i < words.size(); i += threads * 2) {
+                assert(tree.remove(words[i]));
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    done.store(true);
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < words.size(); i++) {
+        auto result = tree.search(words[i]);
+        bool removed = i % threads == i % (threads * 2);
+        if (removed == result.has_value() || (result && *result != i)) {
+            std::cerr << words[i] << " -> unexpected search result" << std::endl;
+            return;
+        }
+        found += result.has_value();
+    }
+    std::cerr << "test_threads Count: " << found << std::endl;
+}
+
+int main() {
+    test_basic();
+    test_threads(200000, 4);
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <netinet/in.h>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+
+using namespace co_io;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+using Address = AddressSolver::Address;
+
+// a listener on an ephemeral loopback port of family
+FileDescriptor listen_on(int family, int backlog, Address &addr) {
+    FileDescriptor fd(::socket(family, SOCK_STREAM, 0));
+    if (fd.fd() == -1) {
+        return fd;
+    }
+    addr = {};
+    if (family == AF_INET6) {
+        auto &in6 = reinterpret_cast<sockaddr_in6 &>(addr.addr_storage_);
+        in6.sin6_family = AF_INET6;
+        in6.sin6_addr = in6addr_loopback;
+        addr.len_ = sizeof(in6);
+    } else {
+        auto &in = reinterpret_cast<sockaddr_in &>(addr.addr_storage_);
+        in.sin_family = AF_INET;
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.len_ = sizeof(in);
+    }
+    if (::bind(fd.fd(), &addr.addr_, addr.len_) == -1 || ::listen(fd.fd(), backlog) == -1) {
+        return FileDescriptor();
+    }
+    system_call(::getsockname(fd.fd(), &addr.addr_, &addr.len_)).execption("getsockname");
+    return fd;
+}
+
+// the port of a socket that was closed again, nobody listens there
+Address closed_port() {
+    Address addr;
+    listen_on(AF_INET, 1, addr);
+    return addr;
+}
+
+// A full accept queue drops the SYN of the next connection, so connecting to it hangs until
+// the first retransmit a second later. The fillers keep the queue full.
+FileDescriptor stalled_listener(Address &addr, std::vector<FileDescriptor> &fillers) {
+    auto fd = listen_on(AF_INET, 0, addr);
+    for (int i = 0; i < 2; i++) {
+        fillers.emplace_back(::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0));
+        ::connect(fillers.back().fd(), &addr.addr_, addr.len_);
+    }
+    return fd;
+}
+
+uint16_t peer_port(int fd) {
+    sockaddr_storage peer{};
+    socklen_t len = sizeof(peer);
+    system_call(::getpeername(fd, reinterpret_cast<sockaddr *>(&peer), &len))
+        .execption("getpeername");
+    return peer.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6 &>(peer).sin6_port
+                                      : reinterpret_cast<sockaddr_in &>(peer).sin_port;
+}
+
+uint16_t port_of(const Address &addr) {
+    return reinterpret_cast<const sockaddr_in &>(addr.addr_storage_).sin_port;
+}
+
+int64_t ms_since(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// connect, wait until writable, then SO_ERROR tells how it went
+Task<void> test_single(LoopBase &loop) {
+    Address good;
+    auto listener = listen_on(AF_INET, 16, good);
+    AsyncFile ok(::socket(AF_INET, SOCK_STREAM, 0), &loop);
+    auto ret = co_await ok.async_connect(good, 1000ms);
+    assert(!ret.is_error() && peer_port(ok.fd()) == port_of(good));
+
+    AsyncFile refused(::socket(AF_INET, SOCK_STREAM, 0), &loop);
+    ret = co_await refused.async_connect(closed_port());
+    assert(ret.is_errno(ECONNREFUSED));
+
+    Address stalled;
+    std::vector<FileDescriptor> fillers;
+    auto full = stalled_listener(stalled, fillers);
+    AsyncFile late(::socket(AF_INET, SOCK_STREAM, 0), &loop);
+    auto start = Clock::now();
+    ret = co_await late.async_connect(stalled, 50ms);
+    assert(ret.is_errno(ETIMEDOUT) && ms_since(start) >= 50);
+    std::cerr << "test_single timeout after " << ms_since(start) << "ms" << std::endl;
+}
+
+Task<void> test_race(LoopBase &loop) {
+    Address good, stalled;
+    auto listener = listen_on(AF_INET, 16, good);
+    std::vector<FileDescriptor> fillers;
+    auto full = stalled_listener(stalled, fillers);
+
+    // the stalled attempt keeps going, the next starts after the delay and wins
+    auto start = Clock::now();
+    std::vector<Address> addrs{stalled, good};
+    auto ret = co_await AsyncFile::async_connect_any(addrs, &loop, 2000ms, 30ms);
+    assert(!ret.is_error() && ms_since(start) >= 30);
+    FileDescriptor winner(ret.value());
+    assert(peer_port(winner.fd()) == port_of(good));
+    std::cerr << "test_race stalled first: " << ms_since(start) << "ms" << std::endl;
+
+    // a refused attempt starts the next at once
+    start = Clock::now();
+    addrs = {closed_port(), good};
+    ret = co_await AsyncFile::async_connect_any(addrs, &loop, 2000ms, 1000ms);
+    assert(!ret.is_error() && ms_since(start) < 500);
+    FileDescriptor second(ret.value());
+    assert(peer_port(second.fd()) == port_of(good));
+
+    // every attempt failed: the last error, or the deadline
+    addrs = {closed_port(), closed_port()};
+    ret = co_await AsyncFile::async_connect_any(addrs, &loop);
+    assert(ret.is_errno(ECONNREFUSED));
+    addrs = {stalled};
+    ret = co_await AsyncFile::async_connect_any(addrs, &loop, 50ms);
+    assert(ret.is_errno(ETIMEDOUT));
+    ret = co_await AsyncFile::async_connect_any({}, &loop);
+    assert(ret.is_error());
+}
+
+// two stalled IPv4 addresses before an IPv6 one: alternating families tries IPv6 second
+Task<void> test_families(LoopBase &loop) {
+    Address good6, stalled;
+    auto listener = listen_on(AF_INET6, 16, good6);
+    if (listener.fd() == -1) {
+        std::cerr << "test_families: no IPv6 loopback, skipped" << std::endl;
+        co_return;
+    }
+    std::vector<FileDescriptor> fillers;
+    auto full = stalled_listener(stalled, fillers);
+    auto start = Clock::now();
+    std::vector<Address> addrs{stalled, stalled, good6};
+    auto ret = co_await AsyncFile::async_connect_any(addrs, &loop, 2000ms, 200ms);
+    assert(!ret.is_error() && ms_since(start) < 350);
+    FileDescriptor winner(ret.value());
+    assert(peer_port(winner.fd()) ==
+           reinterpret_cast<const sockaddr_in6 &>(good6.addr_storage_).sin6_port);
+    std::cerr << "test_families: " << ms_since(start) << "ms" << std::endl;
+}
+
+Task<void> run(LoopBase &loop) {
+    co_await test_single(loop);
+    co_await test_race(loop);
+    co_await test_families(loop);
+    std::cerr << "test_connect Count: 3" << std::endl;
+    loop.stop();
+}
+
+int main() {
+    EPollLoop loop;
+    run_task(run(loop));
+    loop.run();
+    return 0;
+}
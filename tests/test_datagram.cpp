@@ -0,0 +1,113 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "io/async_datagram_socket.hpp"
+#include "io/loop.hpp"
+
+using namespace co_io;
+using Address = AddressSolver::Address;
+
+Address loopback() {
+    Address addr{};
+    auto &in = reinterpret_cast<sockaddr_in &>(addr.addr_storage_);
+    in.sin_family = AF_INET;
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.len_ = sizeof(in);
+    return addr;
+}
+
+uint16_t port_of(const Address &addr) {
+    return reinterpret_cast<const sockaddr_in &>(addr.addr_storage_).sin_port;
+}
+
+// receives datagrams into slots of size bytes until count arrived, GRO ones split up
+Task<std::vector<std::string>> receive(AsyncDatagramSocket &socket, size_t count, size_t size,
+                                       uint16_t from) {
+    std::vector<std::string> payloads;
+    std::vector<std::vector<char>> buffers(AsyncDatagramSocket::MaxBatch, std::vector<char>(size));
+    std::vector<Datagram> batch(AsyncDatagramSocket::MaxBatch);
+    while (payloads.size() < count) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i].buffer = buffers[i];
+        }
+        auto ret = co_await socket.recv_batch(batch);
+        assert(!ret.is_error() && ret.value() > 0);
+        for (size_t i = 0; i < static_cast<size_t>(ret.value()); i++) {
+            assert(port_of(batch[i].peer) == from);
+            std::string data(batch[i].buffer.data(), batch[i].length);
+            size_t step = batch[i].segment_size ? batch[i].segment_size : data.size();
+            for (size_t at = 0; at < data.size(); at += step) {
+                payloads.push_back(data.substr(at, step));
+            }
+            assert(!batch[i].truncated || data.size() == size);
+        }
+    }
+    co_return payloads;
+}
+
+Task<void> run(LoopBase &loop) {
+    auto receiver = AsyncDatagramSocket::bind(loopback(), &loop);
+    auto sender = AsyncDatagramSocket::bind(loopback(), &loop);
+    auto to = receiver.local_address();
+    auto from = port_of(sender.local_address());
+
+    // more than one syscall worth of datagrams, each to an explicit peer, in order
+    constexpr size_t Count = 150;
+    std::vector<std::string> payloads;
+    std::vector<Datagram> batch(Count);
+    for (size_t i = 0; i < Count; i++) {
+        payloads.push_back("datagram " + std::to_string(i));
+    }
+    for (size_t i = 0; i < Count; i++) {
+        batch[i].buffer = payloads[i];
+        batch[i].peer = to;
+    }
+    auto sent = co_await sender.send_batch(batch);
+    assert(!sent.is_error() && sent.value() == static_cast<int>(Count));
+    auto received = co_await receive(receiver, Count, 64, from);
+    assert(received == payloads);
+
+    // a connected socket sends to AF_UNSPEC peers, a short buffer truncates
+    assert(!sender.connect(to).is_error());
+    std::string big(100, 'x');
+    std::vector<Datagram> one(1);
+    one[0].buffer = big;
+    assert((co_await sender.send_batch(one)).value() == 1);
+    received = co_await receive(receiver, 1, 10, from);
+    assert(received.size() == 1 && received[0] == std::string(10, 'x'));
+
+    // GSO sends one buffer as datagrams of segment_size, GRO may hand them back coalesced
+    if (!receiver.enable_gro()) {
+        std::cerr << "test_datagram: no UDP_GRO, skipped" << std::endl;
+    } else {
+        std::string segments = std::string(100, 'a') + std::string(100, 'b') + "cc";
+        one[0].buffer = segments;
+        one[0].segment_size = 100;
+        auto ret = co_await sender.send_batch(one);
+        if (ret.is_error()) {
+            std::cerr << "test_datagram: no UDP_SEGMENT (" << ret.what() << "), skipped"
+                      << std::endl;
+        } else {
+            received = co_await receive(receiver, 3, 1024, from);
+            assert(received == (std::vector<std::string>{std::string(100, 'a'),
+                                                         std::string(100, 'b'), "cc"}));
+        }
+    }
+
+    auto metrics = loop.metrics()->snapshot();
+    std::cerr << "test_datagram Count: " << received.size() << " reads " << metrics.reads
+              << std::endl;
+    loop.stop();
+}
+
+int main() {
+    EPollLoop loop;
+    run_task(run(loop));
+    loop.run();
+    return 0;
+}
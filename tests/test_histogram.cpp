@@ -0,0 +1,118 @@
+#include "utils/histogram.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace co_io;
+
+// percentiles must be within the histogram's relative error of the exact ones
+void test_percentiles(std::mt19937_64 &rng, size_t count) {
+    Histogram histogram;
+    Histogram first_half;
+    Histogram second_half;
+    std::vector<uint64_t> values;
+    std::lognormal_distribution<double> latency(10, 2); // ~22us median, long tail
+    for (size_t i = 0; i < count; i++) {
+        auto value = static_cast<uint64_t>(latency(rng));
+        values.push_back(value);
+        histogram.record(value);
+        (i % 2 ? first_half : second_half).record(value);
+    }
+    first_half.merge(second_half);
+    std::sort(values.begin(), values.end());
+    assert(histogram.min() == values.front() && histogram.max() == values.back());
+
+    const double error = 1.0 / (1 << (Histogram::Precision - 1));
+    for (double p : {0.0, 1.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0}) {
+        auto rank = static_cast<size_t>(std::max(1.0, std::round(p / 100 * count)));
+        auto exact = static_cast<double>(values[rank - 1]);
+        auto reported = static_cast<double>(histogram.percentile(p));
+        if (reported < exact || reported > exact * (1 + error) + 1) {
+            std::cerr << "Error: p" << p << " exact " << exact << " reported " << reported
+                      << std::endl;
+            return;
+        }
+        assert(first_half.percentile(p) == histogram.percentile(p));
+    }
+
+    uint64_t total = 0;
+    uint64_t last = 0;
+    histogram.for_each([&](uint64_t lowest, uint64_t highest, uint64_t n) {
+        assert(lowest >= last && highest >= lowest);
+        last = highest + 1;
+        total += n;
+    });
+    assert(total == count);
+    std::cerr << "test_percentiles p50: " << histogram.percentile(50)
+              << " p999: " << histogram.percentile(99.9) << std::endl;
+}
+
+// small values are exact, values past max_value land in the last bucket
+void test_edges() {
+    Histogram histogram(1000);
+    for (uint64_t i = 0; i < 200; i++) {
+        histogram.record(i);
+    }
+    assert(histogram.percentile(50) == 99);
+    histogram.record(1 << 20, 10);
+    assert(histogram.count() == 210 && histogram.max() == 1 << 20);
+    assert(histogram.percentile(100) == 1 << 20);
+    histogram.reset();
+    assert(histogram.count() == 0 && histogram.percentile(99) == 0);
+}
+
+// threads record into AtomicHistograms, two to each, the merge equals one Histogram of it all
+void test_atomic(std::mt19937_64 &rng) {
+    constexpr size_t Threads = 4;
+    constexpr size_t Values = 100000;
+    std::vector<std::vector<uint64_t>> values(Threads);
+    Histogram expected;
+    for (auto &thread_values : values) {
+        for (size_t i = 0; i < Values; i++) {
+            thread_values.push_back(rng() % 10000000);
+            expected.record(thread_values.back());
+        }
+    }
+    std::vector<AtomicHistogram> histograms(Threads / 2);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < Threads; t++) {
+        threads.emplace_back([&, t] {
+            for (auto value : values[t]) {
+                histograms[t / 2].record(value);
+            }
+        });
+    }
+    Histogram merged;
+    for (auto &histogram : histograms) { // while recording, only to run into races
+        histogram.merge_into(merged);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    merged.reset();
+    for (auto &histogram : histograms) {
+        histogram.merge_into(merged);
+    }
+    assert(merged.count() == expected.count() && merged.mean() == expected.mean());
+    assert(merged.min() == expected.min() && merged.max() == expected.max());
+    for (double p : {1.0, 50.0, 99.0, 99.99}) {
+        assert(merged.percentile(p) == expected.percentile(p));
+    }
+    std::cerr << "test_atomic Count: " << merged.count() << std::endl;
+}
+
+int main() {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937_64 rng(seed);
+
+    test_percentiles(rng, 1000000);
+    test_edges();
+    test_atomic(rng);
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "http/http_client.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+#include "io/timer_context.hpp"
+
+using namespace co_io;
+using namespace std::chrono_literals;
+
+// Answers each request with "<path> <connection>/<request on it>", never answers /slow and
+// closes the connection after /close.
+struct Backend {
+    AsyncFile listener;
+    std::string port;
+    size_t accepted = 0;
+};
+
+Task<void> session(LoopBase &loop, int fd, size_t id) {
+    AsyncFile conn = AsyncFile::adopt(fd, &loop);
+    std::string in;
+    size_t served = 0;
+    char buf[4096];
+    while (true) {
+        auto ret = co_await conn.async_read(buf, sizeof(buf));
+        if (ret.is_error() || ret.value() == 0) {
+            co_return;
+        }
+        in.append(buf, static_cast<size_t>(ret.value()));
+        // requests of a pipeline can arrive in one read
+        for (auto end = in.find("\r\n\r\n"); end != std::string::npos;
+             end = in.find("\r\n\r\n")) {
+            auto head = in.substr(0, end);
+            in.erase(0, end + 4);
+            auto method = head.substr(0, head.find(' '));
+            auto path = head.substr(method.size() + 1, head.find(' ', method.size() + 1) -
+                                                           method.size() - 1);
+            assert(head.find("\r\nHost: 127.0.0.1:") != std::string::npos);
+            if (path == "/slow") {
+                continue;
+            }
+            std::string body = path + " " + std::to_string(id) + "/" + std::to_string(++served);
+            std::string res = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+                              "\r\nX-Path: " + path + "\r\n";
+            res += path == "/close" ? "Connection: close\r\n\r\n" : "\r\n";
+            res += method == "HEAD" ? "" : body;
+            (co_await conn.async_write(res)).execption("write");
+            if (path == "/close") {
+                co_return;
+            }
+        }
+    }
+}
+
+Task<void> serve(LoopBase &loop, Backend &backend) {
+    while (true) {
+        AddressSolver::Address peer;
+        auto fd = co_await backend.listener.async_accept(peer);
+        backend.accepted += 1;
+        run_task(session(loop, fd.execption("accept"), backend.accepted));
+    }
+}
+
+Task<void> fetch(HttpClient &client, std::string port, std::string path,
+                 std::vector<std::string> &bodies) {
+    auto res = co_await client.get("127.0.0.1", port, path);
+    assert(res.status == 200 && res.headers.at("X-Path") == path);
+    assert(!res.headers.contains("Content-Length"));
+    bodies.push_back(res.body);
+}
+
+Task<int> error_of(HttpClient &client, std::string port, std::string path) {
+    try {
+        co_await client.get("127.0.0.1", port, path);
+    } catch (const std::system_error &e) {
+        co_return e.code().value();
+    }
+    co_return 0;
+}
+
+Task<void> run(LoopBase &loop, Backend &backend) {
+    HttpClient client(&loop, {.max_connections = 2, .request_timeout = 200ms});
+    const std::string &port = backend.port;
+
+    // keep-alive: one after the other, all on the first connection
+    for (int i = 1; i <= 3; i++) {
+        auto res = co_await client.get("127.0.0.1", port, "/a");
+        assert(res.body == "/a 1/" + std::to_string(i));
+    }
+    assert(backend.accepted == 1 && client.connections() == 1);
+
+    // six at once on two connections: each request gets its own response back in order
+    std::vector<std::string> bodies;
+    for (int i = 0; i < 6; i++) {
+        run_task(fetch(client, port, "/p" + std::to_string(i), bodies));
+    }
+    while (bodies.size() < 6) {
+        co_await loop.timer()->sleep_for(1ms);
+    }
+    assert(backend.accepted == 2 && client.connections() == 2);
+    for (int i = 0; i < 6; i++) {
+        auto expect = "/p" + std::to_string(i) + " " + (i % 2 == 0 ? "1/" : "2/") +
+                      std::to_string(i % 2 == 0 ? 4 + i / 2 : 1 + i / 2);
+        assert(std::find(bodies.begin(), bodies.end(), expect) != bodies.end());
+    }
+
+    // the response to HEAD has a Content-Length but no body, the next one is parsed as such
+    HttpRequest head;
+    head.method = HttpMethod::HEAD;
+    head.url = "/h";
+    head.args.emplace("q", "a b");
+    auto res = co_await client.request("127.0.0.1", port, head);
+    assert(res.status == 200 && res.body.empty() && res.headers.at("X-Path") == "/h?q=a%20b");
+    res = co_await client.get("127.0.0.1", port, "/after-head");
+    assert(res.body == "/after-head 1/8");
+
+    // a timed out request closes its connection
+    assert(co_await error_of(client, port, "/slow") == ETIMEDOUT);
+    assert(client.connections() == 1);
+
+    // the server closing after a response drops the connection from the pool
+    res = co_await client.get("127.0.0.1", port, "/close");
+    assert(res.body == "/close 2/4");
+    assert(client.connections() == 0);
+    res = co_await client.get("127.0.0.1", port, "/b");
+    assert(res.body == "/b 3/1" && backend.accepted == 3);
+
+    // nobody listens on the port of a closed socket
+    AddressSolver solver{"127.0.0.1", "0"};
+    std::string closed_port;
+    {
+        FileDescriptor socket(AsyncFile::create_listen(solver.get_address_info()));
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        ::getsockname(socket.fd(), reinterpret_cast<sockaddr *>(&addr), &len);
+        closed_port = std::to_string(ntohs(addr.sin_port));
+    }
+    assert(co_await error_of(client, closed_port, "/") == ECONNREFUSED);
+
+    std::cerr << "test_http_client Count: " << backend.accepted << std::endl;
+    loop.stop();
+}
+
+int main() {
+    ::signal(SIGPIPE, SIG_IGN);
+    EPollLoop loop;
+    AddressSolver solver{"127.0.0.1", "0"};
+    auto listener = AsyncFile::bind(solver.get_address_info(), &loop);
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    ::getsockname(listener.fd(), reinterpret_cast<sockaddr *>(&addr), &len);
+    Backend backend{std::move(listener), std::to_string(ntohs(addr.sin_port))};
+
+    run_task(serve(loop, backend));
+    run_task(run(loop, backend));
+    loop.run();
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "io/inbox.hpp"
+#include "io/loop.hpp"
+#include "utils/mpsc_queue.hpp"
+
+using namespace co_io;
+
+// values are producer * Stride + sequence, each producer's values must arrive in order
+constexpr int Stride = 1 << 24;
+
+void test_queue(int producers, int count) {
+    MpscQueue<int> queue(64);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, count] {
+            for (int i = 0; i < count; i++) {
+                while (!queue.try_push(p * Stride + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::vector<int> next(static_cast<size_t>(producers), 0);
+    int received = 0;
+    while (received < producers * count) {
+        int value;
+        if (!queue.try_pop(value)) {
+            continue;
+        }
+        auto &expect = next[static_cast<size_t>(value / Stride)];
+        assert(value % Stride == expect);
+        expect += 1;
+        received += 1;
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    int value;
+    assert(!queue.try_pop(value));
+    std::cerr << "test_queue Count: " << received << std::endl;
+}
+
+Task<void> consume(Inbox<int> &inbox, int total, int &received, LoopBase &loop) {
+    while (received < total) {
+        auto ret = co_await inbox.receive();
+        assert(!ret.is_error());
+        int value;
+        while (inbox.try_pop(value)) {
+            received += 1;
+        }
+    }
+    loop.stop();
+}
+
+// posts from other threads wake the loop, none are lost between wakeups
+void test_inbox(int producers, int count) {
+    EPollLoop loop;
+    Inbox<int> inbox(&loop, 256);
+    int received = 0;
+    run_task(consume(inbox, producers * count, received, loop));
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&inbox, count] {
+            for (int i = 0; i < count; i++) {
+                while (!inbox.post(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    loop.run();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    assert(received == producers * count);
+    std::cerr << "test_inbox Count: " << received << std::endl;
+}
+
+int main() {
+    test_queue(4, 200000);
+    test_inbox(4, 100000);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+
+#include "coroutine/task.hpp"
+#include "coroutine/when_any.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+#include "io/loop_metrics.hpp"
+
+using namespace co_io;
+
+static constexpr size_t Messages = 1000;
+static constexpr size_t MessageSize = 100;
+
+Task<void> reader(AsyncFile &file, size_t &received) {
+    char buf[MessageSize];
+    while (received < Messages * MessageSize) {
+        auto ret = co_await file.async_read(buf, sizeof(buf));
+        assert(!ret.is_error() && ret.value() > 0);
+        received += static_cast<size_t>(ret.value());
+    }
+}
+
+Task<void> writer(AsyncFile &file) {
+    std::string message(MessageSize, 'x');
+    for (size_t i = 0; i < Messages; i++) {
+        auto ret = co_await file.async_write(message);
+        assert(!ret.is_error() && static_cast<size_t>(ret.value()) == MessageSize);
+    }
+}
+
+// the short sleep fires, the long one loses the race and is cancelled
+Task<void> timers(LoopBase &loop) {
+    co_await when_any(loop.timer()->sleep_for(std::chrono::milliseconds(1)),
+                      loop.timer()->sleep_for(std::chrono::hours(1)));
+    co_await loop.timer()->sleep_for(std::chrono::milliseconds(1));
+}
+
+Task<void> run(LoopBase &loop, AsyncFile &in, AsyncFile &out, size_t &received) {
+    run_task(reader(in, received));
+    co_await writer(out);
+    co_await timers(loop);
+    while (received < Messages * MessageSize) {
+        co_await loop.timer()->sleep_for(std::chrono::milliseconds(1));
+    }
+    loop.stop();
+}
+
+// counters match the traffic, another thread may read them while the loop runs
+void test_counters() {
+    EPollLoop loop;
+    int fds[2];
+    system_call(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)).execption("socketpair");
+    AsyncFile in(fds[0], &loop);
+    AsyncFile out(fds[1], &loop);
+    assert(loop.metrics()->snapshot().fds == 3); // with the timer's
+
+    std::atomic<bool> done{false};
+    std::thread observer([&] {
+        uint64_t polls = 0;
+        while (!done.load()) {
+            auto snapshot = loop.metrics()->snapshot();
+            assert(snapshot.polls >= polls);
+            polls = snapshot.polls;
+        }
+    });
+    size_t received = 0;
+    run_task(run(loop, in, out, received));
+    loop.run();
+    done = true;
+    observer.join();
+
+    auto s = loop.metrics()->snapshot();
+    assert(s.write_bytes == Messages * MessageSize && s.writes >= Messages);
+    assert(s.read_bytes >= Messages * MessageSize && s.reads >= s.read_bytes / MessageSize);
+    assert(s.timers_fired >= 2 && s.timers_cancelled >= 1);
+    assert(s.polls > 0 && s.events > 0 && s.resumes > 0);
+    assert(std::accumulate(s.events_per_poll.begin(), s.events_per_poll.end(), 0ul) == s.polls);
+    assert(std::accumulate(s.busy_us.begin(), s.busy_us.end(), 0ul) == s.polls);
+    assert(s.accepts == 0 && s.fds == 3);
+    std::cerr << "test_counters polls: " << s.polls << " events: " << s.events
+              << " reads: " << s.reads << " blocked_ns: " << s.blocked_ns
+              << " busy_ns: " << s.busy_ns << std::endl;
+}
+
+void test_prometheus() {
+    LoopMetrics::Snapshot first;
+    first.polls = 7;
+    first.events_per_poll[0] = 3; // 0 events
+    first.events_per_poll[2] = 4; // 2 or 3 events
+    LoopMetrics::Snapshot second;
+    second.fds = 5;
+    LoopMetrics::Snapshot loops[] = {first, second};
+    auto text = render_prometheus(loops);
+
+    assert(text.find("# TYPE co_io_loop_polls_total counter\n") != std::string::npos);
+    assert(text.find("co_io_loop_polls_total{loop=\"0\"} 7\n") != std::string::npos);
+    assert(text.find("co_io_loop_fds{loop=\"1\"} 5\n") != std::string::npos);
+    assert(text.find("co_io_loop_events_per_poll_bucket{loop=\"0\",le=\"1\"} 3\n") !=
+           std::string::npos);
+    assert(text.find("co_io_loop_events_per_poll_bucket{loop=\"0\",le=\"3\"} 7\n") !=
+           std::string::npos);
+    assert(text.find("co_io_loop_events_per_poll_bucket{loop=\"0\",le=\"+Inf\"} 7\n") !=
+           std::string::npos);
+    assert(text.find("co_io_loop_events_per_poll_count{loop=\"0\"} 7\n") != std::string::npos);
+    std::cerr << "test_prometheus Count: " << text.size() << std::endl;
+}
+
+int main() {
+    test_counters();
+    test_prometheus();
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "utils/persistent_adaptive_radix_tree.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Tree = PersistentAdaptiveRadixTree<int>;
+
+// wide fan-out near the root so every node type gets copied, narrow below
+std::string randstring(std::mt19937 &rng) {
+    std::string key(rng() % 5, ' ');
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = static_cast<char>(i < 2 ? rng() % 80 : 'a' + rng() % 3);
+    }
+    return key;
+}
+
+bool same(const Tree::Snapshot &snapshot, const std::map<std::string, int> &expect) {
+    auto it = snapshot.begin();
+    for (const auto &[key, value] : expect) {
+        if (it == snapshot.end() || it->key != key || it->value != value) {
+            return false;
+        }
+        if (snapshot.find(key) == nullptr || *snapshot.find(key) != value) {
+            return false;
+        }
+        ++it;
+    }
+    return it == snapshot.end();
+}
+
+// every snapshot keeps the contents it was taken with while the tree moves on
+void test_versions(size_t ops) {
+    std::random_device rd;
+    auto seed = rd();
+    std::cerr << "seed: " << seed << std::endl;
+    std::mt19937 rng(seed);
+
+    Tree tree;
+    std::map<std::string, int> expect;
+    std::vector<std::pair<Tree::Snapshot, std::map<std::string, int>>> versions;
+    for (size_t i = 0; i < ops; i++) {
+        auto key = randstring(rng);
+        if (rng() % 3 == 0) {
+            assert(tree.remove(key) == (expect.erase(key) == 1));
+        } else {
+            tree.insert(key, static_cast<int>(i));
+            expect[key] = static_cast<int>(i);
+        }
+        if (i % 997 == 0) {
+            versions.emplace_back(tree.snapshot(), expect);
+        }
+        if (versions.size() > 16) { // drop an old version, its nodes are freed or shared
+            versions.erase(versions.begin() + static_cast<ptrdiff_t>(rng() % versions.size()));
+        }
+    }
+    assert(tree.size() == expect.size());
+    assert(same(tree.snapshot(), expect));
+    for (const auto &[snapshot, contents] : versions) {
+        if (!same(snapshot, contents)) {
+            std::cerr << "snapshot changed" << std::endl;
+            return;
+        }
+    }
+
+    // snapshots outlive the tree
+    Tree::Snapshot last = tree.snapshot();
+    {
+        Tree scratch;
+        scratch.insert("a", 1);
+        last = scratch.snapshot();
+    }
+    assert(last.search("a") == 1);
+    std::cerr << "test_versions Count: " << expect.size() << std::endl;
+}
+
+// Readers scan published versions while the writer inserts batches of keys and publishes
+// after each batch, a reader must never see part of a batch. Every other reader borrows the
+// version through with_published().
+void test_threads(int batches, int batch_size, int readers) {
+    Tree tree;
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            auto scan = [&](const Tree::View &version) {
+                int count = 0;
+                std::string last;
+                for (const auto &leaf : version) {
+                    assert(count == 0 || last < leaf.key);
+                    assert(version.find(leaf.key) == &leaf.value);
+                    last = leaf.key;
+                    count += 1;
+                }
+                return count;
+            };
+            while (!done.load(std::memory_order_acquire)) {
+                int count = r % 2 == 0 ? scan(tree.published()) : tree.with_published(scan);
+                assert(count % batch_size == 0);
+            }
+        });
+    }
+    for (int b = 0; b < batches; b++) {
+        for (int i = 0; i < batch_size; i++) {
+            tree.insert(std::to_string(b * batch_size + i), i);
+        }
+        if (b % 2 == 1) { // removed again one batch later
+            for (int i = 0; i < batch_size; i++) {
+                tree.remove(std::to_string((b - 1) * batch_size + i));
+            }
+        }
+        tree.publish();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::cerr << "test_threads Count: " << tree.size() << std::endl;
+}
+
+int main() {
+    test_versions(200000);
+    test_threads(2000, 50, 4);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <thread>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "coroutine/when_any.hpp"
+#include "io/loop.hpp"
+#include "io/resolver.hpp"
+#include "io/timer_context.hpp"
+
+using namespace co_io;
+using namespace std::chrono_literals;
+using Address = Resolver::Address;
+
+// stands in for the name server: slow, knows "good" and nothing else
+std::atomic<int> lookups{0};
+
+int stub_lookup(const std::string &host, const std::string &port, std::vector<Address> &out) {
+    lookups += 1;
+    std::this_thread::sleep_for(50ms);
+    if (host != "good") {
+        return EAI_NONAME;
+    }
+    Address addr{};
+    auto &in = reinterpret_cast<sockaddr_in &>(addr.addr_storage_);
+    in.sin_family = AF_INET;
+    in.sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.len_ = sizeof(in);
+    out.push_back(addr);
+    return 0;
+}
+
+Task<void> tick(LoopBase &loop, int &ticks, bool &stop) {
+    while (!stop) {
+        co_await loop.timer()->sleep_for(5ms);
+        ticks += 1;
+    }
+}
+
+Task<void> resolve_into(Resolver &resolver, LoopBase &loop, std::vector<Address> &out) {
+    out = co_await resolver.resolve(&loop, "good", "80");
+}
+
+Task<int> error_of(Resolver &resolver, LoopBase &loop, std::string host) {
+    try {
+        co_await resolver.resolve(&loop, host, "80");
+    } catch (const std::system_error &e) {
+        assert(e.code().category() == resolver_category());
+        co_return e.code().value();
+    }
+    co_return 0;
+}
+
+Task<void> run(LoopBase &loop) {
+    Resolver resolver({.ttl = 300ms, .negative_ttl = 300ms}, stub_lookup);
+
+    // the loop keeps running while the lookup blocks a helper thread, and two resolves of
+    // the same name share one lookup
+    int ticks = 0;
+    bool stop = false;
+    run_task(tick(loop, ticks, stop));
+    std::vector<Address> first, second;
+    run_task(resolve_into(resolver, loop, first));
+    co_await resolve_into(resolver, loop, second);
+    while (first.empty()) {
+        co_await loop.timer()->sleep_for(1ms);
+    }
+    assert(lookups == 1 && ticks >= 5);
+    assert(first.size() == 1 && second.size() == 1);
+    assert(ntohs(reinterpret_cast<sockaddr_in &>(first[0].addr_storage_).sin_port) == 80);
+
+    // cached
+    auto start = std::chrono::steady_clock::now();
+    co_await resolve_into(resolver, loop, first);
+    assert(lookups == 1 && std::chrono::steady_clock::now() - start < 10ms);
+
+    // failures are cached too
+    assert(co_await error_of(resolver, loop, "bad") == EAI_NONAME);
+    assert(co_await error_of(resolver, loop, "bad") == EAI_NONAME);
+    assert(lookups == 2);
+
+    // and both expire
+    co_await loop.timer()->sleep_for(350ms);
+    co_await resolve_into(resolver, loop, first);
+    assert(co_await error_of(resolver, loop, "bad") == EAI_NONAME);
+    assert(lookups == 4);
+
+    // a resolve given up on leaves its lookup to finish alone
+    resolver.clear();
+    auto ret = co_await when_any(resolver.resolve(&loop, "good", "80"),
+                                 loop.timer()->sleep_for(10ms));
+    assert(ret.index == 1);
+    co_await loop.timer()->sleep_for(100ms);
+    assert(lookups == 5);
+    co_await resolve_into(resolver, loop, first);
+    assert(lookups == 5 && first.size() == 1);
+
+    // getaddrinfo knows localhost from the hosts file
+    std::vector<Address> local;
+    assert(Resolver::system_lookup("localhost", "80", local) == 0 && !local.empty());
+
+    stop = true;
+    std::cerr << "test_resolver Count: " << lookups << " ticks " << ticks << std::endl;
+    loop.stop();
+}
+
+int main() {
+    EPollLoop loop;
+    run_task(run(loop));
+    loop.run();
+    return 0;
+}
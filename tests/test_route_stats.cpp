@@ -0,0 +1,112 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http/http_router.hpp"
+#include "http/route_stats.hpp"
+
+using namespace co_io;
+
+HttpRequest request(std::string url, HttpMethod method = HttpMethod::GET) {
+    HttpRequest req;
+    req.url = std::move(url);
+    req.method = method;
+    req.version = HttpVersion::HTTP_1_1;
+    req.size = 100;
+    return req;
+}
+
+const RouteStats::Snapshot &find(const std::vector<RouteStats::Snapshot> &routes,
+                                 std::string_view url) {
+    for (const auto &route : routes) {
+        if (route.url == url) {
+            return route;
+        }
+    }
+    assert(false);
+    return routes.front();
+}
+
+// every thread counts into its own shard, the snapshot adds them up
+void test_counts() {
+    constexpr size_t Threads = 4;
+    constexpr size_t Requests = 10000;
+    HttpRouter router;
+    router.route("/ok", HttpMethod::GET, [](HttpRequest) { return HttpResponse{.body = "ok"}; });
+    router.route("/fail", HttpMethod::POST,
+                 [](HttpRequest) { return HttpResponse{.status = 503}; });
+    router.route("/user/[0-9]+", HttpMethod::GET, [](HttpRequest) { return HttpResponse{}; },
+                 true);
+    size_t response_size = HttpResponse{.body = "ok"}.size();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < Threads; t++) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < Requests; i++) {
+                router.handle(request("/ok"));
+                router.handle(request("/fail", HttpMethod::POST));
+                router.handle(request("/user/" + std::to_string(i)));
+                router.handle(request("/missing"));
+            }
+        });
+    }
+    for (size_t i = 0; i < 100; i++) { // readers race the writers
+        router.stats();
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    auto routes = router.stats();
+    assert(routes.size() == 4 && routes.back().method == "*");
+    auto &ok = find(routes, "/ok");
+    assert(ok.requests == Threads * Requests && ok.statuses[2] == ok.requests);
+    assert(ok.bytes_in == ok.requests * 100 && ok.bytes_out == ok.requests * response_size);
+    assert(ok.latency.count() == ok.requests && ok.slow == 0);
+    auto &fail = find(routes, "/fail");
+    assert(fail.method == "POST" && fail.statuses[5] == Threads * Requests);
+    assert(find(routes, "/user/[0-9]+").requests == Threads * Requests);
+    assert(routes.back().statuses[4] == Threads * Requests);
+
+    auto text = render_prometheus(routes);
+    assert(text.find("co_io_route_requests_total{route=\"/fail\",method=\"POST\",code=\"5xx\"} " +
+                     std::to_string(Threads * Requests) + "\n") != std::string::npos);
+    assert(text.find("co_io_route_handler_seconds_count{route=\"/ok\",method=\"GET\"} " +
+                     std::to_string(Threads * Requests) + "\n") != std::string::npos);
+    std::cerr << "test_counts p99: " << ok.latency.percentile(99) << "ns" << std::endl;
+}
+
+// handlers over the threshold are counted and reported, the others are not
+void test_slow() {
+    HttpRouter router;
+    router.route("/slow", HttpMethod::GET, [](HttpRequest) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return HttpResponse{};
+    });
+    router.route("/fast", HttpMethod::GET, [](HttpRequest) { return HttpResponse{}; });
+    std::vector<std::string> reported;
+    router.slow_threshold(std::chrono::microseconds(1000),
+                          [&](const HttpRequest &req, const HttpResponse &res,
+                              std::chrono::nanoseconds elapsed) {
+                              assert(elapsed >= std::chrono::milliseconds(1));
+                              assert(res.status == 200);
+                              reported.push_back(req.url);
+                          });
+    for (int i = 0; i < 3; i++) {
+        router.handle(request("/slow"));
+        router.handle(request("/fast"));
+    }
+    auto routes = router.stats();
+    assert(find(routes, "/slow").slow == 3 && find(routes, "/fast").slow == 0);
+    assert(reported == std::vector<std::string>(3, "/slow"));
+    std::cerr << "test_slow Count: " << reported.size() << std::endl;
+}
+
+int main() {
+    test_counts();
+    test_slow();
+    return 0;
+}
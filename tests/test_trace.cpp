@@ -0,0 +1,75 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+
+#include "coroutine/task.hpp"
+#include "coroutine/trace.hpp"
+#include "io/async_file.hpp"
+#include "io/loop.hpp"
+
+// Only records with the CO_IO_TRACE cmake option, otherwise checks the dumps stay empty.
+
+using namespace co_io;
+
+Task<void> reader(AsyncFile &file) {
+    char buf[16];
+    for (int i = 0; i < 3; i++) {
+        auto ret = co_await file.async_read(buf, sizeof(buf));
+        assert(!ret.is_error() && ret.value() > 0);
+    }
+}
+
+Task<void> writer(LoopBase &loop, AsyncFile &file) {
+    for (int i = 0; i < 3; i++) {
+        co_await loop.timer()->sleep_for(std::chrono::milliseconds(2));
+        co_await file.async_write("ping");
+    }
+}
+
+Task<void> session(LoopBase &loop, AsyncFile &in, AsyncFile &out) {
+    run_task(reader(in));
+    co_await writer(loop, out);
+    loop.stop();
+}
+
+int main() {
+    EPollLoop loop;
+    int fds[2];
+    system_call(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)).execption("socketpair");
+    AsyncFile in(fds[0], &loop);
+    AsyncFile out(fds[1], &loop);
+    run_task(session(loop, in, out));
+    loop.run();
+
+    std::ostringstream summary;
+    trace::dump_summary(summary);
+    std::ostringstream chrome;
+    trace::dump_chrome(chrome);
+    std::cerr << summary.str();
+
+    if (!TraceEnabled) {
+        assert(chrome.str().find("\"ph\"") == std::string::npos);
+        std::cerr << "test_trace: built without CO_IO_TRACE" << std::endl;
+        return 0;
+    }
+    // the reader waits on the fd through async_read, the writer mostly on its timer
+    auto text = summary.str();
+    assert(text.find("reader(co_io::AsyncFile&) -> ") != std::string::npos);
+    assert(text.find("async_read(void*, size_t) -> ") != std::string::npos);
+    assert(text.find("waiting_for_event(PollerBase*, int, PollEvent) -> read") !=
+           std::string::npos);
+    assert(text.find("-> timer") != std::string::npos);
+    auto json = chrome.str();
+    assert(json.front() == '{' && json.find("\"ph\":\"X\"") != std::string::npos);
+    assert(json.find("\"args\":{\"read\":" + std::to_string(fds[0]) + "}") != std::string::npos);
+
+    trace::clear();
+    std::ostringstream empty;
+    trace::dump_summary(empty);
+    assert(empty.str().find('\n') + 1 == empty.str().size()); // only the header
+    std::cerr << "test_trace Count: " << json.size() << std::endl;
+    return 0;
+}